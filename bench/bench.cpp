@@ -0,0 +1,208 @@
+/* C++ standard libraries */
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cfloat>
+
+#include "../include/scene/scene_registry.h"
+#include "../include/scene/scene_optimizer.h"
+#include "../include/accel/accelerator.h"
+#include "../include/render/tile_scheduler.h"
+#include "../include/render/integrator.h"
+#include "../include/stats.h"
+#include "bench_util.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "../libs/stb/stb_image.h"
+
+
+using namespace std;
+
+// Fixed workload of one scene
+struct bench_case {
+	const char *scene;
+	int nx, ny, spp;
+};
+
+const bench_case bench_cases[] = {
+	{ "two_spheres",   200, 120, 64 },
+	{ "random",        200, 120, 64 },
+	{ "cornell_box",   200, 200, 64 },
+	{ "cornell_smoke", 150, 150, 64 },
+	{ "final",         150, 150, 64 }
+};
+
+const int bench_case_count = sizeof(bench_cases) / sizeof(bench_cases[0]);
+
+// Case of a scene, or null
+const bench_case *find_bench_case(const char *scene) {
+	for (int k = 0; k < bench_case_count; k++)
+		if (strcmp(bench_cases[k].scene, scene) == 0) return &bench_cases[k];
+	return 0;
+}
+
+struct bench_result {
+	string scene;
+	int nx, ny, spp, threads;
+	double build_seconds;  // scene builders + accelerator
+	double render_seconds; // median of the runs
+	ray_stats stats;
+};
+
+// Same sampling as main: sample s of pixel (i, j) only depends on (seed, pixel, s)
+void render(const path_integrator& integrator, camera& cam, int nx, int ny, int spp, uint64_t seed, int n_threads) {
+	tile_scheduler scheduler(nx, ny, 16, n_threads);
+	scheduler.run([&](const tile& t, int thread_id) {
+		sampler& smp = thread_sampler();
+		for (int j = t.y0; j < t.y1; j++) {
+			for (int i = t.x0; i < t.x1; i++) {
+				vec3 col(0, 0, 0);
+				for (int s = 0; s < spp; s++) {
+					smp.start_sample(seed, j*nx + i, s);
+					float u = float(i + random_float()) / float(nx);
+					float v = float(j + random_float()) / float(ny);
+					col += integrator.li(cam.get_ray(u, v));
+				}
+				do_not_optimize(col);
+			}
+		}
+	});
+}
+
+bench_result run_case(const bench_case& bc, int spp, int runs, uint64_t seed, int n_threads) {
+	const scene_desc& scene = scene_registry[find_scene(bc.scene)];
+
+	bench_result res;
+	res.scene = bc.scene;
+	res.nx = bc.nx;
+	res.ny = bc.ny;
+	res.spp = spp > 0 ? spp : bc.spp;
+	res.threads = n_threads;
+
+	clock_type::time_point start = clock_type::now();
+	thread_sampler().seed(seed);
+	hittable *world = optimize_scene(build_scene(scene));
+	int n_accelerated, n_separate;
+	world = build_accelerator(world, 0.0, 1.0, n_accelerated, n_separate);
+	res.build_seconds = seconds_since(start);
+
+	camera cam = scene.make_camera(res.nx, res.ny);
+	path_integrator integrator(world, scene.make_light(), 50, 3, scene.use_ambient);
+
+	// Counts are the same for every run, the time is the median
+	timing_summary t = measure([&]() {
+		reset_stats();
+		render(integrator, cam, res.nx, res.ny, res.spp, seed, n_threads);
+		res.stats = collect_stats();
+	}, 0, runs);
+	res.render_seconds = t.median;
+	return res;
+}
+
+double per_second(uint64_t n, double seconds) { return seconds > 0 ? n / seconds : 0; }
+double average(uint64_t a, uint64_t b) { return b > 0 ? double(a) / double(b) : 0; }
+
+void print_text(const vector<bench_result>& results) {
+	printf("%-14s %9s %5s %8s %9s %12s %12s %9s %10s\n",
+		   "scene", "size", "spp", "build s", "render s", "primary/s", "rays/s", "path len", "nodes/ray");
+	for (size_t k = 0; k < results.size(); k++) {
+		const bench_result& r = results[k];
+		char size[32];
+		snprintf(size, sizeof(size), "%dx%d", r.nx, r.ny);
+		printf("%-14s %9s %5d %8.3f %9.3f %11.3fM %11.3fM %9.3f %10.2f\n",
+			   r.scene.c_str(), size, r.spp, r.build_seconds, r.render_seconds,
+			   per_second(r.stats.camera_rays, r.render_seconds) * 1e-6,
+			   per_second(r.stats.rays, r.render_seconds) * 1e-6,
+			   average(r.stats.rays, r.stats.camera_rays),
+			   average(r.stats.bvh_nodes, r.stats.rays));
+	}
+}
+
+string to_json(const vector<bench_result>& results, uint64_t seed, int runs) {
+	ostringstream out;
+	out << "{\n  \"seed\": " << seed << ",\n  \"runs\": " << runs << ",\n  \"scenes\": [\n";
+	for (size_t k = 0; k < results.size(); k++) {
+		const bench_result& r = results[k];
+		out << "    {\"scene\": \"" << r.scene << "\", \"width\": " << r.nx << ", \"height\": " << r.ny
+			<< ", \"spp\": " << r.spp << ", \"threads\": " << r.threads
+			<< ", \"build_seconds\": " << r.build_seconds << ", \"render_seconds\": " << r.render_seconds
+			<< ", \"camera_rays\": " << r.stats.camera_rays << ", \"rays\": " << r.stats.rays
+			<< ", \"bvh_nodes\": " << r.stats.bvh_nodes
+			<< ", \"primary_rays_per_second\": " << per_second(r.stats.camera_rays, r.render_seconds)
+			<< ", \"rays_per_second\": " << per_second(r.stats.rays, r.render_seconds)
+			<< ", \"average_path_length\": " << average(r.stats.rays, r.stats.camera_rays)
+			<< ", \"bvh_nodes_per_ray\": " << average(r.stats.bvh_nodes, r.stats.rays) << "}"
+			<< (k+1 < results.size() ? ",\n" : "\n");
+	}
+	out << "  ]\n}\n";
+	return out.str();
+}
+
+/*
+ * bench
+ *
+ * Under bench directory...
+ * Compile: g++ -std=c++11 -O2 -pthread -DPT_STATS bench.cpp -o bench
+ * Run:	    ./bench [--scene name]... [--spp N] [--runs N] [--threads N] [--seed N] [--json file]
+ *
+*/
+int main(int argc, char * argv[]) {
+	vector<string> only;
+	int spp = 0; // 0 = per-case sample count
+	int runs = 3;
+	int n_threads = default_thread_count();
+	uint64_t seed = 0;
+	const char *json = 0;
+	bool bad_option = false;
+	for (int k = 1; k < argc; k++) {
+		if (strcmp(argv[k], "--scene") == 0 && k+1 < argc) only.push_back(argv[++k]);
+		else if (strcmp(argv[k], "--spp") == 0 && k+1 < argc) spp = atoi(argv[++k]);
+		else if (strcmp(argv[k], "--runs") == 0 && k+1 < argc) runs = atoi(argv[++k]);
+		else if (strcmp(argv[k], "--threads") == 0 && k+1 < argc) n_threads = atoi(argv[++k]);
+		else if (strcmp(argv[k], "--seed") == 0 && k+1 < argc) seed = strtoull(argv[++k], 0, 10);
+		else if (strcmp(argv[k], "--json") == 0 && k+1 < argc) json = argv[++k];
+		else bad_option = true;
+	}
+	if (runs < 1 || n_threads < 1) bad_option = true;
+	// A misspelled --scene would otherwise leave an empty table
+	for (size_t k = 0; k < only.size(); k++) {
+		if (!find_bench_case(only[k].c_str())) {
+			cerr << "Unknown bench scene " << only[k] << endl;
+			bad_option = true;
+		}
+	}
+	if (bad_option) {
+		cerr << "Usage: ./bench [--scene name]... [--spp N] [--runs N] [--threads N] [--seed N] [--json file]" << endl;
+		return 1;
+	}
+
+#ifndef PT_STATS
+	cerr << "Built without -DPT_STATS: ray counts will be zero" << endl;
+#endif
+
+	vector<bench_result> results;
+	for (int k = 0; k < bench_case_count; k++) {
+		const bench_case& bc = bench_cases[k];
+		if (!only.empty() && find(only.begin(), only.end(), string(bc.scene)) == only.end()) continue;
+		results.push_back(run_case(bc, spp, runs, seed, n_threads));
+	}
+
+	printf("%d threads, seed %llu, median of %d runs\n", n_threads, (unsigned long long)seed, runs);
+	print_text(results);
+
+	if (json) {
+		ofstream out(json);
+		out << to_json(results, seed, runs);
+		if (!out) {
+			cerr << "Failed to write " << json << endl;
+			return 1;
+		}
+	}
+	return 0;
+}
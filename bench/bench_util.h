@@ -0,0 +1,57 @@
+#ifndef BENCHUTILH
+#define BENCHUTILH
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+typedef std::chrono::steady_clock clock_type;
+
+inline double seconds_since(clock_type::time_point start) {
+	return std::chrono::duration<double>(clock_type::now() - start).count();
+}
+
+// Keeps the compiler from dropping work whose result is never used
+// (value is treated as read by an opaque instruction, and memory as clobbered)
+template <typename T>
+inline void do_not_optimize(const T& value) {
+	asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// Summary of repeated timings
+struct timing_summary {
+	double min, median, mean, stddev;
+};
+
+inline timing_summary summarize(std::vector<double> samples) {
+	timing_summary s;
+	std::sort(samples.begin(), samples.end());
+	s.min = samples[0];
+	s.median = samples[samples.size() / 2];
+
+	double sum = 0;
+	for (size_t k = 0; k < samples.size(); k++) sum += samples[k];
+	s.mean = sum / samples.size();
+
+	double sq = 0;
+	for (size_t k = 0; k < samples.size(); k++) sq += (samples[k] - s.mean) * (samples[k] - s.mean);
+	s.stddev = samples.size() > 1 ? sqrt(sq / (samples.size() - 1)) : 0;
+	return s;
+}
+
+// Runs body() warmup times untimed, then reps times timed; seconds per call
+template <typename F>
+timing_summary measure(F body, int warmup, int reps) {
+	for (int k = 0; k < warmup; k++) body();
+
+	std::vector<double> times;
+	for (int k = 0; k < reps; k++) {
+		clock_type::time_point start = clock_type::now();
+		body();
+		times.push_back(seconds_since(start));
+	}
+	return summarize(times);
+}
+
+#endif
@@ -0,0 +1,255 @@
+/* C++ standard libraries */
+#include <iostream>
+#include <cstring>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <cfloat>
+
+#include "../include/scene/scene_registry.h"
+#include "../include/accel/accelerator.h"
+#include "../include/render/integrator.h"
+#include "../include/texture/perlin.h"
+#include "../include/pdf/pdf.h"
+#include "../include/onb.h"
+#include "../include/hittable/triangle_mesh.h"
+#include "bench_util.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "../libs/stb/stb_image.h"
+
+
+using namespace std;
+
+// One ray traced by the integrator and what it hit
+struct traced_ray {
+	ray r;
+	bool hit;
+	vec3 p, normal;
+};
+
+// Passes hit() through to the scene and records every query
+class recording_hittable : public hittable {
+	public:
+		recording_hittable(hittable *h, vector<traced_ray> *out) : inner(h), rays(out) {}
+
+		virtual bool hit(const ray& r, float t_min, float t_max, hit_record& rec) const {
+			traced_ray t;
+			t.r = r;
+			t.hit = inner->hit(r, t_min, t_max, rec);
+			if (t.hit) {
+				t.p = rec.p;
+				t.normal = rec.normal;
+			}
+			rays->push_back(t);
+			return t.hit;
+		}
+		virtual bool bounding_box(float t0, float t1, aabb& box) const { return inner->bounding_box(t0, t1, box); }
+
+		hittable *inner;
+		vector<traced_ray> *rays;
+};
+
+// Camera and bounce rays of a small Cornell box render (single thread, seed 0)
+vector<traced_ray> capture_cornell_rays(int nx, int ny, int spp) {
+	const scene_desc& scene = scene_registry[find_scene("cornell_box")];
+	thread_sampler().seed(0);
+	int n_accelerated, n_separate;
+	hittable *world = build_accelerator(build_scene(scene), 0.0, 1.0, n_accelerated, n_separate);
+
+	vector<traced_ray> rays;
+	recording_hittable recorder(world, &rays);
+	camera cam = scene.make_camera(nx, ny);
+	path_integrator integrator(&recorder, scene.make_light(), 50, 3, scene.use_ambient);
+
+	sampler& smp = thread_sampler();
+	for (int j = 0; j < ny; j++) {
+		for (int i = 0; i < nx; i++) {
+			for (int s = 0; s < spp; s++) {
+				smp.start_sample(0, j*nx + i, s);
+				float u = float(i + random_float()) / float(nx);
+				float v = float(j + random_float()) / float(ny);
+				integrator.li(cam.get_ray(u, v));
+			}
+		}
+	}
+	return rays;
+}
+
+struct kernel_result {
+	string name;
+	size_t ops;
+	timing_summary t; // seconds per pass over the inputs
+};
+
+struct microbench {
+	microbench(int w, int r, const char *f) : warmup(w), reps(r), filter(f) {}
+
+	// body() runs the kernel once per input and returns a checksum, which is kept alive
+	template <typename F>
+	void run(const char *name, size_t ops, F body) {
+		if (filter && !strstr(name, filter)) return;
+
+		kernel_result res;
+		res.name = name;
+		res.ops = ops;
+		res.t = measure([&]() { do_not_optimize(body()); }, warmup, reps);
+		results.push_back(res);
+	}
+
+	void print() const {
+		printf("%-26s %9s %9s %9s %9s %7s %10s\n", "kernel", "inputs", "min ns", "median ns", "mean ns", "stddev", "Mops/s");
+		for (size_t k = 0; k < results.size(); k++) {
+			const kernel_result& r = results[k];
+			double scale = 1e9 / r.ops;
+			printf("%-26s %9zu %9.2f %9.2f %9.2f %6.1f%% %10.2f\n", r.name.c_str(), r.ops,
+				   r.t.min * scale, r.t.median * scale, r.t.mean * scale,
+				   r.t.mean > 0 ? 100 * r.t.stddev / r.t.mean : 0.0, r.ops / r.t.median * 1e-6);
+		}
+	}
+
+	int warmup, reps;
+	const char *filter;
+	vector<kernel_result> results;
+};
+
+// Every query against one object, returns the number of hits
+int hit_all(const hittable& h, const vector<traced_ray>& rays) {
+	int hits = 0;
+	hit_record rec;
+	for (size_t k = 0; k < rays.size(); k++)
+		if (h.hit(rays[k].r, 0.001, FLT_MAX, rec)) hits++;
+	return hits;
+}
+
+/*
+ * microbench
+ *
+ * Under bench directory...
+ * Compile: g++ -std=c++11 -O2 -pthread microbench.cpp -o microbench
+ * Run:	    ./microbench [--filter name] [--reps N] [--warmup N] [--size N] [--spp N]
+ *
+*/
+int main(int argc, char * argv[]) {
+	const char *filter = 0;
+	int reps = 15;
+	int warmup = 3;
+	int size = 64;
+	int spp = 4;
+	bool bad_option = false;
+	for (int k = 1; k < argc; k++) {
+		if (strcmp(argv[k], "--filter") == 0 && k+1 < argc) filter = argv[++k];
+		else if (strcmp(argv[k], "--reps") == 0 && k+1 < argc) reps = atoi(argv[++k]);
+		else if (strcmp(argv[k], "--warmup") == 0 && k+1 < argc) warmup = atoi(argv[++k]);
+		else if (strcmp(argv[k], "--size") == 0 && k+1 < argc) size = atoi(argv[++k]);
+		else if (strcmp(argv[k], "--spp") == 0 && k+1 < argc) spp = atoi(argv[++k]);
+		else bad_option = true;
+	}
+	if (reps < 1 || warmup < 0 || size < 1 || spp < 1) bad_option = true;
+	if (bad_option) {
+		cerr << "Usage: ./microbench [--filter name] [--reps N] [--warmup N] [--size N] [--spp N]" << endl;
+		return 1;
+	}
+
+	vector<traced_ray> rays = capture_cornell_rays(size, size, spp);
+	vector<traced_ray> hits;
+	for (size_t k = 0; k < rays.size(); k++)
+		if (rays[k].hit) hits.push_back(rays[k]);
+	printf("Cornell box %dx%d, %d spp: %zu rays captured, %zu hit\n", size, size, spp, rays.size(), hits.size());
+
+	microbench mb(warmup, reps, filter);
+
+	// Objects of the Cornell box (and the glass sphere its light list mentions)
+	sphere glass(vec3(190, 90, 190), 90, 0);
+	moving_sphere moving(vec3(190, 90, 190), vec3(220, 90, 190), 0, 1, 90, 0);
+	xy_rect back(0, 555, 0, 555, 555, 0);
+	xz_rect ground(0, 555, 0, 555, 0, 0);
+	yz_rect left(0, 555, 0, 555, 555, 0);
+	aabb short_box(vec3(130, 0, 65), vec3(295, 165, 230));
+
+	mb.run("sphere::hit", rays.size(), [&]() { return hit_all(glass, rays); });
+	mb.run("moving_sphere::hit", rays.size(), [&]() { return hit_all(moving, rays); });
+	mb.run("xy_rect::hit", rays.size(), [&]() { return hit_all(back, rays); });
+	mb.run("xz_rect::hit", rays.size(), [&]() { return hit_all(ground, rays); });
+	mb.run("yz_rect::hit", rays.size(), [&]() { return hit_all(left, rays); });
+	mb.run("aabb::hit", rays.size(), [&]() {
+		int n = 0;
+		for (size_t k = 0; k < rays.size(); k++)
+			if (short_box.hit(rays[k].r, 0.001, FLT_MAX)) n++;
+		return n;
+	});
+	// Lower left half of the back wall
+	vec3 tri0(0, 0, 555), tri1(555, 0, 555), tri2(0, 555, 555);
+	mb.run("intersect_triangle", rays.size(), [&]() {
+		int n = 0;
+		for (size_t k = 0; k < rays.size(); k++) {
+			float t, b0, b1, b2;
+			if (intersect_triangle(watertight_ray(rays[k].r), tri0, tri1, tri2, 0.001, FLT_MAX, t, b0, b1, b2)) n++;
+		}
+		return n;
+	});
+
+	// BVHs over the objects of the scene, one per layout
+	vector<hittable*> objects;
+	thread_sampler().seed(0);
+	collect_objects(build_scene(scene_registry[find_scene("cornell_box")]), objects);
+	bvh_node bvh(&objects[0], int(objects.size()), 0, 1);
+	bvh4 wide4(&objects[0], int(objects.size()), 0, 1);
+	bvh8 wide8(&objects[0], int(objects.size()), 0, 1);
+	mb.run("bvh_node::hit", rays.size(), [&]() { return hit_all(bvh, rays); });
+	mb.run("bvh4::hit", rays.size(), [&]() { return hit_all(wide4, rays); });
+	mb.run("bvh8::hit", rays.size(), [&]() { return hit_all(wide8, rays); });
+
+	// Shading kernels on the hit points, normals and directions of the captured rays
+	perlin noise;
+	mb.run("perlin::noise", hits.size(), [&]() {
+		float sum = 0;
+		for (size_t k = 0; k < hits.size(); k++) sum += noise.noise(0.1 * hits[k].p);
+		return sum;
+	});
+	mb.run("perlin::turb", hits.size(), [&]() {
+		float sum = 0;
+		for (size_t k = 0; k < hits.size(); k++) sum += noise.turb(0.1 * hits[k].p);
+		return sum;
+	});
+	mb.run("get_sphere_uv", rays.size(), [&]() {
+		float sum = 0;
+		for (size_t k = 0; k < rays.size(); k++) {
+			float u, v;
+			get_sphere_uv(unit_vector(rays[k].r.direction()), u, v);
+			sum += u + v;
+		}
+		return sum;
+	});
+	mb.run("schlick", hits.size(), [&]() {
+		float sum = 0;
+		for (size_t k = 0; k < hits.size(); k++)
+			sum += schlick(fabs(dot(unit_vector(hits[k].r.direction()), hits[k].normal)), 1.5);
+		return sum;
+	});
+	mb.run("onb::build_from_w", hits.size(), [&]() {
+		vec3 sum(0, 0, 0);
+		onb uvw;
+		for (size_t k = 0; k < hits.size(); k++) {
+			uvw.build_from_w(hits[k].normal);
+			sum += uvw.u();
+		}
+		return sum;
+	});
+
+	// Samplers draw from the sequential stream of this thread
+	thread_sampler().seed(1);
+	mb.run("random_cosine_direction", rays.size(), [&]() {
+		vec3 sum(0, 0, 0);
+		for (size_t k = 0; k < rays.size(); k++) sum += random_cosine_direction();
+		return sum;
+	});
+	mb.run("random_in_unit_sphere", rays.size(), [&]() {
+		vec3 sum(0, 0, 0);
+		for (size_t k = 0; k < rays.size(); k++) sum += random_in_unit_sphere();
+		return sum;
+	});
+
+	mb.print();
+	return 0;
+}
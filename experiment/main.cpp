@@ -11,8 +11,8 @@ inline float pdf_3(float x) { return 3*x*x/8; } // p(x) = 3/8 * x^2
 inline float pdf_4(const vec3& p) { return 1 / (4*M_PI); }
 
 inline vec3 random_cosine_direction() {
-	float r1 = random_double();
-	float r2 = random_double();
+	float r1 = random_float();
+	float r2 = random_float();
 	float z = sqrt(1-r2);
 	float phi = 2*M_PI*r1;
 	float x = cos(phi)*sqrt(r2);
@@ -58,8 +58,8 @@ void random_limited_iteration() {
 	int N = 1000;
 	int inside_circle = 0;
 	for (int i = 0; i < N; i++) {
-		float x = 2*random_double() - 1;
-		float y = 2*random_double() - 1;
+		float x = 2*random_float() - 1;
+		float y = 2*random_float() - 1;
 		if(x*x + y*y < 1)
 			inside_circle++;
 	}
@@ -74,8 +74,8 @@ void random_forever_iteration() {
 	int runs = 0;
 	while (true) {
 		runs++;
-		float x = 2*random_double() - 1;
-		float y = 2*random_double() - 1;
+		float x = 2*random_float() - 1;
+		float y = 2*random_float() - 1;
 		if(x*x + y*y < 1)
 			inside_circle++;
 
@@ -101,12 +101,12 @@ void stratified() {
 	int sqrt_N = 10000;
 	for (int i = 0; i < sqrt_N; i++) {
 		for (int j = 0; j < sqrt_N; j++) {
-			float x = 2*random_double() - 1;
-			float y = 2*random_double() - 1;
+			float x = 2*random_float() - 1;
+			float y = 2*random_float() - 1;
 			if (x*x + y*y < 1)
 				inside_circle++;
-			x = 2*((i + random_double()) / sqrt_N) - 1;
-			y = 2*((j + random_double()) / sqrt_N) - 1;
+			x = 2*((i + random_float()) / sqrt_N) - 1;
+			y = 2*((j + random_float()) / sqrt_N) - 1;
 			if (x*x + y*y < 1)
 				inside_circle_stratified++;
 		}
@@ -138,7 +138,7 @@ void monte_carlo() {
 	float sum;
 	for (int i = 0; i < N; i++) {
 		// get random number between 0 and 2
-		float x = 2*random_double();
+		float x = 2*random_float();
 		sum += x*x;
 	}
 	// Finally average the sum of sampling in [0, 2) * 2
@@ -154,7 +154,7 @@ void nonuniform_sample() {
 	int N = 1000000;
 	float sum;
 	for (int i = 0; i < N; i++) {
-		float x = sqrt(4*random_double()); // <- P-1(x)
+		float x = sqrt(4*random_float()); // <- P-1(x)
 		// weight is 1/pdf(x)
 		sum += x*x / pdf(x);
 	}
@@ -166,7 +166,7 @@ void uniform_sample() {
 	int N = 1000000;
 	float sum;
 	for (int i = 0; i < N; i++) {
-		float x = 2*random_double(); // <- P-1(x)
+		float x = 2*random_float(); // <- P-1(x)
 		sum += x*x / pdf_2(x);
 	}
 	std::cout << "I = " << sum/N << "\n";
@@ -177,7 +177,7 @@ void nonuniform_sample_2() {
 	int N = 1;
 	float sum;
 	for (int i = 0; i < N; i++) {
-		float x = pow(8*random_double(), 1./3.); // <- P-1(x)
+		float x = pow(8*random_float(), 1./3.); // <- P-1(x)
 		sum += x*x / pdf_3(x);
 	}
 	std::cout << "I =" << sum/N << "\n";
@@ -198,8 +198,8 @@ void random_direction_on_hemisphere() {
 	int N = 1000000;
 	float sum = 0.0;
 	for (int i = 0; i < N; i++) {
-		float r1 = random_double();
-		float r2 = random_double();
+		float r1 = random_float();
+		float r2 = random_float();
 		float x = cos(2*M_PI*r1)*2*sqrt(r2*(1-r2));
 		float y = sin(2*M_PI*r1)*2*sqrt(r2*(1-r2));
 		float z = 1 - r2;
@@ -224,7 +224,7 @@ vec3 random_on_unit_sphere_test() {
 	vec3 p;
 
 	do {
-		p = 2.0*vec3(random_double(), random_double(), random_double()) - vec3(1,1,1);
+		p = 2.0*vec3(random_float(), random_float(), random_float()) - vec3(1,1,1);
 	} while (dot(p,p) >= 1.0);
 	
 	return unit_vector(p);
@@ -1,17 +1,27 @@
 #ifndef AABBH
 #define AABBH
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "stats.h"
+
 inline float ffmin(float a, float b) { return a < b ? a : b; } // if (a < b) is true, return a. Otherwise return b
 inline float ffmax(float a, float b) { return a > b ? a : b; }
 
+// Slab distances are rounded, so a ray through an edge or corner of a box could miss it by an ulp
+// Scaling the exit distance by 1 + 2*gamma(3) keeps the test conservative (Ize, Robust BVH Ray Traversal)
+const float aabb_far_scale = 1.0000004f;
+
 // Axis-align vounding box
 class aabb {
 	public:
 		aabb() {}
 		aabb(const vec3& a, const vec3& b) { _min = a; _max = b; }
 
-		vec3 min() const { return _min; }
-		vec3 max() const { return _max; }
+		const vec3& min() const { return _min; }
+		const vec3& max() const { return _max; }
 		bool hit(const ray& r, float tmin, float tmax) const;
 
 		// bounding box range
@@ -19,25 +29,46 @@ class aabb {
 		vec3 _max;
 };
 
+// Branchless slab test using the ray's precomputed 1/direction
+// min/max pick the near and far plane per axis, so there is no swap and no early exit to mispredict
+// A touching ray (entry == exit) counts as a hit, so boxes of zero thickness are not lost
+#if defined(__SSE2__)
+inline bool aabb::hit(const ray& r, float tmin, float tmax) const {
+	PT_STAT(aabb_tests);
+	__m128 o   = _mm_setr_ps(r.A[0], r.A[1], r.A[2], 0.0f);
+	__m128 inv = _mm_setr_ps(r.inv_B[0], r.inv_B[1], r.inv_B[2], 0.0f);
+	__m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_setr_ps(_min[0], _min[1], _min[2], 0.0f), o), inv); // tx0 = (x0-Ax)/B
+	__m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_setr_ps(_max[0], _max[1], _max[2], 0.0f), o), inv); // tx1 = (x1-Ax)/B
+	// Lane 3 is 0*0: put the [tmin, tmax] range there so it takes part in the reduction
+	__m128 tnear = _mm_move_ss(_mm_shuffle_ps(_mm_min_ps(t0, t1), _mm_min_ps(t0, t1), _MM_SHUFFLE(2, 1, 0, 3)), _mm_set_ss(tmin));
+	__m128 t_exit = _mm_mul_ps(_mm_max_ps(t0, t1), _mm_set1_ps(aabb_far_scale));
+	__m128 tfar  = _mm_move_ss(_mm_shuffle_ps(t_exit, t_exit, _MM_SHUFFLE(2, 1, 0, 3)), _mm_set_ss(tmax));
+
+	// Largest entry and smallest exit over the 4 lanes
+	tnear = _mm_max_ps(tnear, _mm_shuffle_ps(tnear, tnear, _MM_SHUFFLE(1, 0, 3, 2)));
+	tnear = _mm_max_ss(tnear, _mm_shuffle_ps(tnear, tnear, _MM_SHUFFLE(2, 3, 0, 1)));
+	tfar  = _mm_min_ps(tfar, _mm_shuffle_ps(tfar, tfar, _MM_SHUFFLE(1, 0, 3, 2)));
+	tfar  = _mm_min_ss(tfar, _mm_shuffle_ps(tfar, tfar, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_comile_ss(tnear, tfar);
+}
+#else
 inline bool aabb::hit(const ray& r, float tmin, float tmax) const {
+	PT_STAT(aabb_tests);
 	for (int a = 0; a < 3; a++) {
-		float invD = 1.0f / r.direction()[a];
-		float t0 = (min()[a] - r.origin()[a]) * invD; // tx0 = (x0-Ax)/B where x0 is smaller attribute of BB in x-axis (_min)
-		float t1 = (max()[a] - r.origin()[a]) * invD; // tx1 = (x1-Ax)/B where x1 = _max
-		
-		if (invD < 0.0f) std::swap(t0, t1); // when direction is negative
-		
-		// make sure the t0 and t1 are in range (tmin, tmax) for the actual intersect
-		tmin = t0 > tmin ? t0 : tmin;
-		tmax = t1 < tmax ? t1 : tmax;
+		float t0 = (_min[a] - r.A[a]) * r.inv_B[a]; // tx0 = (x0-Ax)/B where x0 is smaller attribute of BB in x-axis (_min)
+		float t1 = (_max[a] - r.A[a]) * r.inv_B[a]; // tx1 = (x1-Ax)/B where x1 = _max
 
-		if (tmax <= tmin) return false;
+		// make sure the t0 and t1 are in range (tmin, tmax) for the actual intersect
+		// (a NaN from 0*inf loses against the running range because it is the first argument)
+		tmin = ffmax(ffmin(t0, t1), tmin);
+		tmax = ffmin(ffmax(t0, t1) * aabb_far_scale, tmax);
 	}
-	return true;
+	return tmin <= tmax;
 }
+#endif
 
 // Compound BBs
-aabb surrounding_box(aabb box0, aabb box1) {
+aabb surrounding_box(const aabb& box0, const aabb& box1) {
 	// Get the smallest attribute
 	vec3 small(
 				ffmin(box0.min().x(), box1.min().x()),
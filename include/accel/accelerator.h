@@ -0,0 +1,120 @@
+#ifndef ACCELERATORH
+#define ACCELERATORH
+
+#include <vector>
+
+#include "../hittable/hittable_list.h"
+#include "../hittable/bvh_node.h"
+#include "../hittable/wide_bvh.h"
+#include "../trace.h"
+
+enum bvh_layout {
+	bvh_binary, // flattened binary tree (bvh_node)
+	bvh_wide4,  // 4 children per node, SSE
+	bvh_wide8   // 8 children per node, AVX
+};
+
+// Layout used by make_bvh(), chosen on the command line
+bvh_layout default_bvh_layout = bvh_binary;
+
+// Scene builders call this instead of constructing a bvh_node directly
+hittable *make_bvh(hittable **l, int n, float time0, float time1) {
+	trace_scope scope("make_bvh", "bvh", 0, n);
+	switch (default_bvh_layout) {
+		case bvh_wide4:
+			return new bvh4(l, n, time0, time1);
+		case bvh_wide8:
+			return new bvh8(l, n, time0, time1);
+		default:
+			return new bvh_node(l, n, time0, time1);
+	}
+}
+
+// Objects below any of the BVH layouts (in leaf order), or null when h is not a BVH
+const std::vector<hittable*> *bvh_objects(const hittable *h) {
+	if (const bvh_node *b = dynamic_cast<const bvh_node*>(h)) return &b->prims;
+	if (const bvh4 *b = dynamic_cast<const bvh4*>(h)) return &b->prims;
+	if (const bvh8 *b = dynamic_cast<const bvh8*>(h)) return &b->prims;
+	return 0;
+}
+
+std::vector<hittable*> *bvh_objects(hittable *h) {
+	return const_cast<std::vector<hittable*>*>(bvh_objects(static_cast<const hittable*>(h)));
+}
+
+// An object whose box has more than this times the area of the box around everything else
+// (a ground sphere, a fog boundary) would make every top-level node huge, so it stays out of the BVH
+const float large_object_ratio = 4.0f;
+
+// Top-level objects of the world, with lists and BVHs opened up
+void collect_objects(hittable *h, std::vector<hittable*>& objects) {
+	if (hittable_list *hl = dynamic_cast<hittable_list*>(h)) {
+		for (int i = 0; i < hl->list_size; i++) collect_objects(hl->list[i], objects);
+		return;
+	}
+	if (const std::vector<hittable*> *inner = bvh_objects(h)) {
+		for (size_t i = 0; i < inner->size(); i++) collect_objects((*inner)[i], objects);
+		return;
+	}
+	objects.push_back(h);
+}
+
+// Builds one BVH over the whole world
+// Unbounded and very large objects are tested linearly next to it
+hittable *build_accelerator(hittable *world, float time0, float time1, int& n_accelerated, int& n_separate) {
+	trace_scope scope("build_accelerator", "bvh");
+	std::vector<hittable*> objects;
+	collect_objects(world, objects);
+
+	int n = int(objects.size());
+	std::vector<aabb> boxes(n);
+	std::vector<bool> bounded(n);
+	for (int i = 0; i < n; i++) bounded[i] = objects[i]->bounding_box(time0, time1, boxes[i]);
+
+	// suffix[i] = box around the bounded objects i..n-1, so "everything else" costs O(1) per object
+	std::vector<aabb> suffix(n+1);
+	std::vector<bool> suffix_valid(n+1, false);
+	for (int i = n-1; i >= 0; i--) {
+		suffix_valid[i] = suffix_valid[i+1] || bounded[i];
+		if (bounded[i]) suffix[i] = suffix_valid[i+1] ? surrounding_box(boxes[i], suffix[i+1]) : boxes[i];
+		else suffix[i] = suffix[i+1];
+	}
+
+	std::vector<hittable*> accelerated, separate;
+	aabb prefix;
+	bool prefix_valid = false;
+	for (int i = 0; i < n; i++) {
+		bool large = false;
+		if (bounded[i]) {
+			bool others_valid = prefix_valid || suffix_valid[i+1];
+			if (others_valid) {
+				aabb others = !prefix_valid ? suffix[i+1]
+							: !suffix_valid[i+1] ? prefix : surrounding_box(prefix, suffix[i+1]);
+				large = surface_area(boxes[i]) > large_object_ratio * surface_area(others);
+			}
+			prefix = prefix_valid ? surrounding_box(prefix, boxes[i]) : boxes[i];
+			prefix_valid = true;
+		}
+
+		if (bounded[i] && !large) accelerated.push_back(objects[i]);
+		else separate.push_back(objects[i]);
+	}
+
+	n_accelerated = int(accelerated.size());
+	n_separate = int(separate.size());
+
+	hittable **list = new hittable*[separate.size() + 1];
+	int size = 0;
+	if (accelerated.size() == 1) list[size++] = accelerated[0];
+	else if (accelerated.size() > 1) list[size++] = make_bvh(&accelerated[0], int(accelerated.size()), time0, time1);
+	for (size_t i = 0; i < separate.size(); i++) list[size++] = separate[i];
+
+	if (size == 1) {
+		hittable *only = list[0];
+		delete [] list;
+		return only;
+	}
+	return new hittable_list(list, size);
+}
+
+#endif
@@ -0,0 +1,225 @@
+#ifndef BVHBUILDERH
+#define BVHBUILDERH
+
+#include <algorithm>
+#include <cfloat>
+#include <deque>
+#include <vector>
+
+#include "../ray.h"
+#include "../aabb.h"
+#include "../random.h"
+
+// Relative costs used by the surface area heuristic
+const float bvh_traversal_cost = 1.0f;   // one node (box) test
+const float bvh_intersection_cost = 1.0f; // one primitive test
+
+enum bvh_split_method {
+	split_sah,   // binned surface area heuristic
+	split_median // random axis, median split, 1-2 primitives per leaf (the original builder)
+};
+
+struct bvh_build_node {
+	aabb bounds;
+	bvh_build_node *children[2]; // both null for a leaf
+	int split_axis;
+	int first_prim, n_prims;     // leaf: range in bvh_builder::prim_order
+};
+
+// Builds a binary BVH over primitive bounds only, so the same builder serves
+// lists of hittables and the triangles of a mesh
+class bvh_builder {
+	public:
+		bvh_builder(const std::vector<aabb>& prim_bounds, int max_leaf_size = 4,
+					bvh_split_method method = split_sah);
+
+		float sah_cost() const;
+
+		bvh_build_node *root;
+		std::deque<bvh_build_node> nodes; // deque keeps node pointers stable while growing
+		std::vector<int> prim_order;      // primitive indices in leaf order
+		int max_leaf_size;
+		bvh_split_method method;
+
+	private:
+		// Per-primitive data computed once before the build
+		struct prim_info {
+			aabb bounds;
+			vec3 centroid;
+			int index;
+		};
+
+		bvh_build_node *build(std::vector<prim_info>& info, int start, int end);
+		bvh_build_node *make_leaf(std::vector<prim_info>& info, int start, int end, const aabb& bounds);
+		int partition_sah(std::vector<prim_info>& info, int start, int end, const aabb& bounds, int& axis);
+		int partition_median(std::vector<prim_info>& info, int start, int end, int& axis);
+};
+
+inline float surface_area(const aabb& b) {
+	vec3 d = b.max() - b.min();
+	return 2 * (d.x()*d.y() + d.y()*d.z() + d.z()*d.x());
+}
+
+bvh_builder::bvh_builder(const std::vector<aabb>& prim_bounds, int max_leaf, bvh_split_method m)
+	: root(0), max_leaf_size(max_leaf < 1 ? 1 : max_leaf), method(m) {
+	int n = int(prim_bounds.size());
+	if (n == 0) return;
+
+	std::vector<prim_info> info(n);
+	for (int i = 0; i < n; i++) {
+		info[i].bounds = prim_bounds[i];
+		info[i].centroid = 0.5f*(prim_bounds[i].min() + prim_bounds[i].max());
+		info[i].index = i;
+	}
+
+	prim_order.reserve(n);
+	root = build(info, 0, n);
+}
+
+bvh_build_node *bvh_builder::make_leaf(std::vector<prim_info>& info, int start, int end, const aabb& bounds) {
+	nodes.push_back(bvh_build_node());
+	bvh_build_node *node = &nodes.back();
+	node->bounds = bounds;
+	node->children[0] = node->children[1] = 0;
+	node->split_axis = 0;
+	node->first_prim = int(prim_order.size());
+	node->n_prims = end - start;
+	for (int i = start; i < end; i++)
+		prim_order.push_back(info[i].index);
+	return node;
+}
+
+bvh_build_node *bvh_builder::build(std::vector<prim_info>& info, int start, int end) {
+	aabb bounds = info[start].bounds;
+	for (int i = start+1; i < end; i++)
+		bounds = surrounding_box(bounds, info[i].bounds);
+
+	int n = end - start;
+	if (n == 1) return make_leaf(info, start, end, bounds);
+
+	int axis;
+	int mid;
+	if (method == split_median) {
+		if (n <= 2) return make_leaf(info, start, end, bounds);
+		mid = partition_median(info, start, end, axis);
+	}
+	else {
+		mid = partition_sah(info, start, end, bounds, axis);
+		if (mid < 0) return make_leaf(info, start, end, bounds);
+	}
+
+	nodes.push_back(bvh_build_node());
+	bvh_build_node *node = &nodes.back();
+	node->split_axis = axis;
+	node->first_prim = 0;
+	node->n_prims = 0;
+	node->children[0] = build(info, start, mid);
+	node->children[1] = build(info, mid, end);
+	node->bounds = bounds;
+	return node;
+}
+
+// Returns the split index, or -1 when a leaf is cheaper than any split
+int bvh_builder::partition_sah(std::vector<prim_info>& info, int start, int end, const aabb& bounds, int& axis) {
+	const int n_bins = 16;
+	int n = end - start;
+
+	aabb centroid_bounds(info[start].centroid, info[start].centroid);
+	for (int i = start+1; i < end; i++)
+		centroid_bounds = surrounding_box(centroid_bounds, aabb(info[i].centroid, info[i].centroid));
+
+	float best_cost = FLT_MAX;
+	int best_axis = -1, best_bin = -1;
+
+	for (int a = 0; a < 3; a++) {
+		float cmin = centroid_bounds.min()[a];
+		float extent = centroid_bounds.max()[a] - cmin;
+		if (extent <= 0) continue; // all centroids in one plane along this axis
+
+		int count[n_bins] = {0};
+		aabb bin_bounds[n_bins];
+		for (int i = start; i < end; i++) {
+			int b = int(n_bins * ((info[i].centroid[a] - cmin) / extent));
+			if (b >= n_bins) b = n_bins-1;
+			if (count[b]++ == 0) bin_bounds[b] = info[i].bounds;
+			else bin_bounds[b] = surrounding_box(bin_bounds[b], info[i].bounds);
+		}
+
+		// Sweep from the right once so each split plane costs O(1) to evaluate
+		float right_area[n_bins];
+		int right_count[n_bins];
+		aabb acc;
+		int acc_count = 0;
+		for (int b = n_bins-1; b > 0; b--) {
+			if (count[b] > 0) acc = acc_count > 0 ? surrounding_box(acc, bin_bounds[b]) : bin_bounds[b];
+			acc_count += count[b];
+			right_count[b] = acc_count;
+			right_area[b] = acc_count > 0 ? surface_area(acc) : 0;
+		}
+
+		acc_count = 0;
+		for (int b = 0; b < n_bins-1; b++) {
+			if (count[b] > 0) acc = acc_count > 0 ? surrounding_box(acc, bin_bounds[b]) : bin_bounds[b];
+			acc_count += count[b];
+			if (acc_count == 0 || right_count[b+1] == 0) continue;
+
+			float cost = acc_count*surface_area(acc) + right_count[b+1]*right_area[b+1];
+			if (cost < best_cost) {
+				best_cost = cost;
+				best_axis = a;
+				best_bin = b;
+			}
+		}
+	}
+
+	float area = surface_area(bounds);
+	float leaf_cost = n * bvh_intersection_cost;
+
+	if (best_axis < 0) {
+		// Centroids coincide: nothing to gain from SAH, split the range in half if the leaf is too big
+		if (n <= max_leaf_size) return -1;
+		axis = 0;
+		return start + n/2;
+	}
+
+	float split_cost = bvh_traversal_cost + bvh_intersection_cost * best_cost / (area > 0 ? area : 1);
+	if (n <= max_leaf_size && leaf_cost <= split_cost) return -1;
+
+	axis = best_axis;
+	float cmin = centroid_bounds.min()[axis];
+	float extent = centroid_bounds.max()[axis] - cmin;
+	int split_axis = axis;
+	std::vector<prim_info>::iterator mid = std::partition(info.begin() + start, info.begin() + end, [=](const prim_info& p) {
+		int b = int(n_bins * ((p.centroid[split_axis] - cmin) / extent));
+		if (b >= n_bins) b = n_bins-1;
+		return b <= best_bin;
+	});
+	return int(mid - info.begin());
+}
+
+// The original builder: random axis, sort by the lower corner, split in the middle
+int bvh_builder::partition_median(std::vector<prim_info>& info, int start, int end, int& axis) {
+	axis = int(3*random_float());
+	int a = axis;
+	std::sort(info.begin() + start, info.begin() + end, [=](const prim_info& p, const prim_info& q) {
+		return p.bounds.min()[a] < q.bounds.min()[a];
+	});
+	return start + (end - start)/2;
+}
+
+// Expected cost of a random ray that hits the root box
+float bvh_builder::sah_cost() const {
+	if (!root) return 0;
+	float root_area = surface_area(root->bounds);
+	if (root_area <= 0) root_area = 1;
+
+	float cost = 0;
+	for (size_t i = 0; i < nodes.size(); i++) {
+		float p = surface_area(nodes[i].bounds) / root_area;
+		if (nodes[i].children[0]) cost += p * bvh_traversal_cost;
+		else cost += p * nodes[i].n_prims * bvh_intersection_cost;
+	}
+	return cost;
+}
+
+#endif
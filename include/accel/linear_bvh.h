@@ -0,0 +1,97 @@
+#ifndef LINEARBVHH
+#define LINEARBVHH
+
+#include <stdint.h>
+#include <vector>
+
+#include "bvh_builder.h"
+#include "../stats.h"
+
+// Compact BVH node stored in one contiguous array (two per 64-byte cache line)
+// Depth-first layout: the first child of an interior node is the next entry in the array
+struct linear_bvh_node {
+	aabb bounds;
+	union {
+		int32_t prim_offset;         // leaf: first primitive in leaf order
+		int32_t second_child_offset; // interior: index of the second child
+	};
+	uint16_t n_prims;                // 0 for an interior node
+	uint8_t axis;                    // split axis, picks the near child during traversal
+	uint8_t pad;
+};
+
+static_assert(sizeof(linear_bvh_node) == 32, "linear_bvh_node must stay 32 bytes");
+
+// Maximum depth the traversal stack can hold
+const int bvh_stack_size = 64;
+
+int flatten_bvh(const bvh_build_node *node, std::vector<linear_bvh_node>& nodes) {
+	int offset = int(nodes.size());
+	nodes.push_back(linear_bvh_node());
+	nodes[offset].bounds = node->bounds;
+	nodes[offset].pad = 0;
+
+	if (!node->children[0]) {
+		nodes[offset].prim_offset = node->first_prim;
+		nodes[offset].n_prims = uint16_t(node->n_prims);
+		nodes[offset].axis = 0;
+	}
+	else {
+		nodes[offset].n_prims = 0;
+		nodes[offset].axis = uint8_t(node->split_axis);
+		flatten_bvh(node->children[0], nodes);
+		int second = flatten_bvh(node->children[1], nodes);
+		nodes[offset].second_child_offset = second;
+	}
+	return offset;
+}
+
+// Compiles a built tree into the linear layout
+std::vector<linear_bvh_node> flatten_bvh(const bvh_builder& tree) {
+	std::vector<linear_bvh_node> nodes;
+	nodes.reserve(tree.nodes.size());
+	if (tree.root) flatten_bvh(tree.root, nodes);
+	return nodes;
+}
+
+// Walks the linear BVH with an explicit stack, near child first
+// hit_prim(int prim, float& t_max) tests one primitive in leaf order; on a hit it
+// returns true and lowers t_max, which then culls every node behind the hit
+template <typename F>
+inline bool traverse_bvh(const linear_bvh_node *nodes, const ray& r, float t_min, float t_max, F hit_prim) {
+	int stack[bvh_stack_size];
+	int stack_top = 0;
+	int current = 0;
+	bool hit_anything = false;
+	int visited = 0;
+
+	for (;;) {
+		const linear_bvh_node& node = nodes[current];
+		visited++;
+		if (node.bounds.hit(r, t_min, t_max)) {
+			if (node.n_prims > 0) {
+				for (int i = 0; i < node.n_prims; i++)
+					if (hit_prim(node.prim_offset + i, t_max)) hit_anything = true;
+			}
+			else if (r.sign[node.axis]) {
+				// Ray goes towards lower coordinates: the second child is nearer
+				stack[stack_top++] = current + 1;
+				current = node.second_child_offset;
+				continue;
+			}
+			else {
+				stack[stack_top++] = node.second_child_offset;
+				current = current + 1;
+				continue;
+			}
+		}
+
+		if (stack_top == 0) break;
+		current = stack[--stack_top];
+	}
+
+	PT_STAT_ADD(bvh_nodes, visited);
+	return hit_anything;
+}
+
+#endif
@@ -0,0 +1,118 @@
+#ifndef WIDEAABBH
+#define WIDEAABBH
+
+#include <cfloat>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+#include "../ray.h"
+#include "../aabb.h"
+#include "../stats.h"
+
+// N boxes stored as structure of arrays (all min x, then all min y, ...)
+// so one ray is tested against all of them with a single instruction sequence
+template <int N>
+struct wide_aabb {
+	// Unused slots are empty (min = +inf, max = -inf) and never hit
+	void set_empty(int i) {
+		for (int a = 0; a < 3; a++) {
+			bmin[a][i] = FLT_MAX;
+			bmax[a][i] = -FLT_MAX;
+		}
+	}
+
+	void set(int i, const aabb& b) {
+		for (int a = 0; a < 3; a++) {
+			bmin[a][i] = b.min()[a];
+			bmax[a][i] = b.max()[a];
+		}
+	}
+
+	// Bit i of the result is set when box i is hit within [tmin, tmax]; t_entry[i] is where the ray enters it
+	int hit(const ray& r, float tmin, float tmax, float *t_entry) const;
+
+	float bmin[3][N];
+	float bmax[3][N];
+};
+
+// Portable version
+// The near plane is picked from the ray's sign bits instead of min/max, which keeps empty slots a miss
+template <int N>
+inline int wide_aabb<N>::hit(const ray& r, float tmin, float tmax, float *t_entry) const {
+	PT_STAT_ADD(aabb_tests, N);
+	float tnear[N], tfar[N];
+	for (int i = 0; i < N; i++) {
+		tnear[i] = tmin;
+		tfar[i] = tmax;
+	}
+
+	for (int a = 0; a < 3; a++) {
+		const float *near = r.sign[a] ? bmax[a] : bmin[a];
+		const float *far  = r.sign[a] ? bmin[a] : bmax[a];
+		for (int i = 0; i < N; i++) {
+			tnear[i] = ffmax((near[i] - r.A[a]) * r.inv_B[a], tnear[i]);
+			tfar[i]  = ffmin((far[i]  - r.A[a]) * r.inv_B[a] * aabb_far_scale, tfar[i]);
+		}
+	}
+
+	int mask = 0;
+	for (int i = 0; i < N; i++) {
+		t_entry[i] = tnear[i];
+		if (tnear[i] <= tfar[i]) mask |= 1 << i;
+	}
+	return mask;
+}
+
+#if defined(__SSE2__)
+// 4 boxes per SSE register
+template <>
+inline int wide_aabb<4>::hit(const ray& r, float tmin, float tmax, float *t_entry) const {
+	PT_STAT_ADD(aabb_tests, 4);
+	__m128 tnear = _mm_set1_ps(tmin);
+	__m128 tfar  = _mm_set1_ps(tmax);
+	__m128 scale = _mm_set1_ps(aabb_far_scale);
+
+	for (int a = 0; a < 3; a++) {
+		__m128 o   = _mm_set1_ps(r.A[a]);
+		__m128 inv = _mm_set1_ps(r.inv_B[a]);
+		const float *near = r.sign[a] ? bmax[a] : bmin[a];
+		const float *far  = r.sign[a] ? bmin[a] : bmax[a];
+		// max/min return the second operand on NaN, so 0*inf never poisons the running range
+		tnear = _mm_max_ps(_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(near), o), inv), tnear);
+		tfar  = _mm_min_ps(_mm_mul_ps(_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(far), o), inv), scale), tfar);
+	}
+
+	_mm_storeu_ps(t_entry, tnear);
+	return _mm_movemask_ps(_mm_cmple_ps(tnear, tfar));
+}
+#endif
+
+#if defined(__AVX__)
+// 8 boxes per AVX register (build with -mavx or -march=native)
+template <>
+inline int wide_aabb<8>::hit(const ray& r, float tmin, float tmax, float *t_entry) const {
+	PT_STAT_ADD(aabb_tests, 8);
+	__m256 tnear = _mm256_set1_ps(tmin);
+	__m256 tfar  = _mm256_set1_ps(tmax);
+	__m256 scale = _mm256_set1_ps(aabb_far_scale);
+
+	for (int a = 0; a < 3; a++) {
+		__m256 o   = _mm256_set1_ps(r.A[a]);
+		__m256 inv = _mm256_set1_ps(r.inv_B[a]);
+		const float *near = r.sign[a] ? bmax[a] : bmin[a];
+		const float *far  = r.sign[a] ? bmin[a] : bmax[a];
+		tnear = _mm256_max_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(near), o), inv), tnear);
+		tfar  = _mm256_min_ps(_mm256_mul_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(far), o), inv), scale), tfar);
+	}
+
+	_mm256_storeu_ps(t_entry, tnear);
+	return _mm256_movemask_ps(_mm256_cmp_ps(tnear, tfar, _CMP_LE_OQ));
+}
+#endif
+
+#endif
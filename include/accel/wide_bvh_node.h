@@ -0,0 +1,137 @@
+#ifndef WIDEBVHNODEH
+#define WIDEBVHNODEH
+
+#include <stdint.h>
+#include <vector>
+
+#include "bvh_builder.h"
+#include "../stats.h"
+#include "wide_aabb.h"
+
+// N-wide BVH node: the boxes of all children are tested by one wide_aabb<N>::hit
+template <int N>
+struct wide_bvh_node {
+	wide_aabb<N> bounds;   // child boxes (SoA)
+	int32_t child[N];      // inner child: node index, leaf child: first primitive in leaf order
+	int32_t n_prims[N];    // 0 for an inner child, -1 for an empty slot
+};
+
+// Largest number of pending children during traversal (depth * (N-1) + N)
+const int wide_bvh_stack_size = 256;
+
+// Pulls up to N children into one node by repeatedly opening the inner child with the largest surface area
+template <int N>
+int collapse_bvh(const bvh_build_node *node, std::vector<wide_bvh_node<N> >& nodes) {
+	int index = int(nodes.size());
+	nodes.push_back(wide_bvh_node<N>());
+
+	const bvh_build_node *children[N];
+	int n = 0;
+	if (!node->children[0]) children[n++] = node; // a lone leaf at the root
+	else {
+		children[n++] = node->children[0];
+		children[n++] = node->children[1];
+	}
+
+	while (n < N) {
+		int best = -1;
+		float best_area = -1;
+		for (int i = 0; i < n; i++) {
+			if (children[i]->children[0] && surface_area(children[i]->bounds) > best_area) {
+				best = i;
+				best_area = surface_area(children[i]->bounds);
+			}
+		}
+		if (best < 0) break; // only leaves left
+
+		const bvh_build_node *opened = children[best];
+		children[best] = opened->children[0];
+		children[n++] = opened->children[1];
+	}
+
+	// nodes may grow (and move) while the children are collapsed, so fill in a local copy
+	wide_bvh_node<N> wide;
+	for (int i = 0; i < N; i++) {
+		if (i >= n) {
+			wide.bounds.set_empty(i);
+			wide.child[i] = 0;
+			wide.n_prims[i] = -1;
+			continue;
+		}
+
+		wide.bounds.set(i, children[i]->bounds);
+		if (!children[i]->children[0]) {
+			wide.child[i] = children[i]->first_prim;
+			wide.n_prims[i] = children[i]->n_prims;
+		}
+		else {
+			wide.child[i] = collapse_bvh<N>(children[i], nodes);
+			wide.n_prims[i] = 0;
+		}
+	}
+	nodes[index] = wide;
+	return index;
+}
+
+template <int N>
+std::vector<wide_bvh_node<N> > collapse_bvh(const bvh_builder& tree) {
+	std::vector<wide_bvh_node<N> > nodes;
+	if (tree.root) collapse_bvh<N>(tree.root, nodes);
+	return nodes;
+}
+
+// Same contract as traverse_bvh: hit_prim(int prim, float& t_max) lowers t_max on a hit
+// Children that are hit get pushed far to near, so the nearest one is popped first,
+// and an entry whose box starts behind the closest hit is dropped without a test
+template <int N, typename F>
+inline bool traverse_wide_bvh(const wide_bvh_node<N> *nodes, const ray& r, float t_min, float t_max, F hit_prim) {
+	struct entry {
+		int32_t child;
+		int32_t n_prims;
+		float t;
+	};
+
+	entry stack[wide_bvh_stack_size];
+	int stack_top = 0;
+	bool hit_anything = false;
+	int visited = 0;
+
+	entry root = { 0, 0, t_min };
+	stack[stack_top++] = root;
+
+	while (stack_top > 0) {
+		entry e = stack[--stack_top];
+		if (e.t > t_max) continue;
+
+		if (e.n_prims > 0) {
+			for (int i = 0; i < e.n_prims; i++)
+				if (hit_prim(e.child + i, t_max)) hit_anything = true;
+			continue;
+		}
+
+		const wide_bvh_node<N>& node = nodes[e.child];
+		visited++;
+		float t_entry[N];
+		int mask = node.bounds.hit(r, t_min, t_max, t_entry);
+
+		// Insertion sort of the (few) hit children by entry distance while pushing
+		int base = stack_top;
+		while (mask) {
+			int i = __builtin_ctz(mask);
+			mask &= mask - 1;
+
+			entry c = { node.child[i], node.n_prims[i], t_entry[i] };
+			int j = stack_top++;
+			while (j > base && stack[j-1].t < c.t) {
+				stack[j] = stack[j-1];
+				j--;
+			}
+			stack[j] = c;
+		}
+	}
+
+	PT_STAT_ADD(bvh_nodes, visited);
+	return hit_anything;
+}
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef AFFINEH
+#define AFFINEH
+
+#include <cfloat>
+#include <cmath>
+
+#include "aabb.h"
+
+// 3x4 affine transform: p' = L p + t, stored row by row with t in the last column
+class affine {
+	public:
+		affine() {
+			for (int i = 0; i < 3; i++)
+				for (int j = 0; j < 4; j++) m[i][j] = i == j ? 1.0f : 0.0f;
+		}
+
+		vec3 point(const vec3& p) const {
+			return vec3(m[0][0]*p[0] + m[0][1]*p[1] + m[0][2]*p[2] + m[0][3],
+						m[1][0]*p[0] + m[1][1]*p[1] + m[1][2]*p[2] + m[1][3],
+						m[2][0]*p[0] + m[2][1]*p[1] + m[2][2]*p[2] + m[2][3]);
+		}
+		vec3 vector(const vec3& v) const {
+			return vec3(m[0][0]*v[0] + m[0][1]*v[1] + m[0][2]*v[2],
+						m[1][0]*v[0] + m[1][1]*v[1] + m[1][2]*v[2],
+						m[2][0]*v[0] + m[2][1]*v[1] + m[2][2]*v[2]);
+		}
+		// L^T v: called on the inverse, this carries normals (the inverse transpose of L)
+		vec3 transposed_vector(const vec3& v) const {
+			return vec3(m[0][0]*v[0] + m[1][0]*v[1] + m[2][0]*v[2],
+						m[0][1]*v[0] + m[1][1]*v[1] + m[2][1]*v[2],
+						m[0][2]*v[0] + m[1][2]*v[1] + m[2][2]*v[2]);
+		}
+
+		affine inverse() const;
+
+		float m[3][4];
+};
+
+// a after b
+inline affine operator*(const affine& a, const affine& b) {
+	affine c;
+	for (int i = 0; i < 3; i++) {
+		for (int j = 0; j < 4; j++) {
+			c.m[i][j] = a.m[i][0]*b.m[0][j] + a.m[i][1]*b.m[1][j] + a.m[i][2]*b.m[2][j];
+			if (j == 3) c.m[i][j] += a.m[i][3];
+		}
+	}
+	return c;
+}
+
+// Inverse of L by cofactors (in double), then t' = -L^-1 t; L must not be singular
+affine affine::inverse() const {
+	double c[3][3];
+	for (int i = 0; i < 3; i++) {
+		for (int j = 0; j < 3; j++) {
+			int i1 = (i+1) % 3, i2 = (i+2) % 3, j1 = (j+1) % 3, j2 = (j+2) % 3;
+			c[j][i] = double(m[i1][j1]) * m[i2][j2] - double(m[i1][j2]) * m[i2][j1]; // adjugate = cofactors transposed
+		}
+	}
+	double det = m[0][0]*c[0][0] + m[0][1]*c[1][0] + m[0][2]*c[2][0];
+
+	affine r;
+	for (int i = 0; i < 3; i++) {
+		for (int j = 0; j < 3; j++) r.m[i][j] = float(c[i][j] / det);
+		r.m[i][3] = float(-(c[i][0]*m[0][3] + c[i][1]*m[1][3] + c[i][2]*m[2][3]) / det);
+	}
+	return r;
+}
+
+inline affine translation(const vec3& offset) {
+	affine a;
+	for (int i = 0; i < 3; i++) a.m[i][3] = offset[i];
+	return a;
+}
+
+// Same direction as rotate_y: x' = cos*x + sin*z, z' = -sin*x + cos*z
+inline affine rotation_y(float degrees) {
+	float radians = (M_PI / 180.) * degrees;
+	affine a;
+	a.m[0][0] = cos(radians);
+	a.m[0][2] = sin(radians);
+	a.m[2][0] = -sin(radians);
+	a.m[2][2] = cos(radians);
+	return a;
+}
+
+inline affine scaling(float s) {
+	affine a;
+	for (int i = 0; i < 3; i++) a.m[i][i] = s;
+	return a;
+}
+
+// Box around the 8 transformed corners
+aabb transform_box(const affine& a, const aabb& box) {
+	vec3 min(FLT_MAX, FLT_MAX, FLT_MAX);
+	vec3 max(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	for (int corner = 0; corner < 8; corner++) {
+		vec3 p((corner & 1) ? box.max()[0] : box.min()[0],
+			   (corner & 2) ? box.max()[1] : box.min()[1],
+			   (corner & 4) ? box.max()[2] : box.min()[2]);
+		vec3 q = a.point(p);
+		for (int c = 0; c < 3; c++) {
+			min[c] = ffmin(min[c], q[c]);
+			max[c] = ffmax(max[c], q[c]);
+		}
+	}
+	return aabb(min, max);
+}
+
+#endif
@@ -41,7 +41,7 @@ class camera {
 			vec3 rd = lens_radius*random_in_unit_disk();
 			vec3 offset = u * rd.x() + v * rd.y();
 			// Get a ray at random time between time0 and time1 while opening shutter
-			float time = time0 + random_double()*(time1-time0);
+			float time = time0 + random_float()*(time1-time0);
 
 			// direction vector is
 			// dir = (center->(s,t)) - (center->offset)
@@ -64,7 +64,7 @@ vec3 random_in_unit_disk() {
 
 	do {
 		// Randomly get (x,y,0) within [-1,1) until get a point inside of unit disk
-		p = 2.0*vec3(random_double(),random_double(),0) - vec3(1,1,0);
+		p = 2.0*vec3(random_float(),random_float(),0) - vec3(1,1,0);
 	} while (dot(p,p) >= 1.0);
 
 	return p;
@@ -1,12 +1,17 @@
 #ifndef BOXH
 #define BOXH
 
+#include <algorithm>
+#include <cfloat>
+
 #include "hittable.h"
 
+// Axis-aligned box, intersected with one slab test instead of six rects
+// Normals point outward and u, v are those of the rects the box used to be made of
 class box: public hittable {
 	public:
 		box() {}
-		box(const vec3& p0, const vec3& p1, material *ptr);
+		box(const vec3& p0, const vec3& p1, material *ptr) : pmin(p0), pmax(p1), mp(ptr) {}
 
 		virtual bool hit(const ray& r, float t0, float t1, hit_record& rec) const;
 		virtual bool bounding_box(float t0, float t1, aabb& box) const {
@@ -15,25 +20,51 @@ class box: public hittable {
 		}
 
 		vec3 pmin, pmax;
-		hittable *list_ptr;
+		material *mp;
 };
 
-box::box(const vec3& p0, const vec3& p1, material *ptr) {
-	pmin = p0;
-	pmax = p1;
-
-	hittable **list = new hittable*[6];
-	list[0] = new xy_rect(p0.x(), p1.x(), p0.y(), p1.y(), p1.z(), ptr);
-	list[1] = new flip_normals(new xy_rect(p0.x(), p1.x(), p0.y(), p1.y(), p0.z(), ptr));
-	list[2] = new xz_rect(p0.x(), p1.x(), p0.z(), p1.z(), p1.y(), ptr);
-	list[3] = new flip_normals(new xz_rect(p0.x(), p1.x(), p0.z(), p1.z(), p0.y(), ptr));
-	list[4] = new yz_rect(p0.y(), p1.y(), p0.z(), p1.z(), p1.x(), ptr);
-	list[5] = new flip_normals(new yz_rect(p0.y(), p1.y(), p0.z(), p1.z(), p0.x(), ptr));
-	list_ptr = new hittable_list(list,6);
-}
-
 bool box::hit(const ray& r, float t0, float t1, hit_record& rec) const {
-	return list_ptr->hit(r, t0, t1, rec);
+	PT_STAT(box_tests);
+	// Entry and exit distance, and the axis of the face each one crosses
+	float t_enter = -FLT_MAX, t_exit = FLT_MAX;
+	int enter_axis = 0, exit_axis = 0;
+	for (int a = 0; a < 3; a++) {
+		float ta = (pmin[a] - r.A[a]) * r.inv_B[a];
+		float tb = (pmax[a] - r.A[a]) * r.inv_B[a];
+		if (ta > tb) std::swap(ta, tb);
+		if (ta > t_enter) { t_enter = ta; enter_axis = a; }
+		if (tb < t_exit) { t_exit = tb; exit_axis = a; }
+	}
+	if (t_enter > t_exit) return false;
+
+	// First face crossed within [t0, t1]: the entry, or the exit for a ray that starts inside
+	float t;
+	int axis;
+	bool max_face;
+	if (t_enter >= t0 && t_enter <= t1) {
+		t = t_enter;
+		axis = enter_axis;
+		max_face = r.B[axis] < 0;
+	}
+	else if (t_exit >= t0 && t_exit <= t1) {
+		t = t_exit;
+		axis = exit_axis;
+		max_face = r.B[axis] > 0;
+	}
+	else return false;
+
+	rec.t = t;
+	rec.mat_ptr = mp;
+	rec.p = r.point_at_parameter(t);
+	rec.normal = vec3(0, 0, 0);
+	rec.normal[axis] = max_face ? 1 : -1;
+
+	// xy faces: u = x, v = y; xz faces: u = x, v = z; yz faces: u = y, v = z
+	int ua = axis == 0 ? 1 : 0;
+	int va = axis == 2 ? 1 : 2;
+	rec.u = (rec.p[ua] - pmin[ua]) / (pmax[ua] - pmin[ua]);
+	rec.v = (rec.p[va] - pmin[va]) / (pmax[va] - pmin[va]);
+	return true;
 }
 
 #endif
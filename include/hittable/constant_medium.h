@@ -24,9 +24,10 @@ class constant_medium : public hittable {
 };
 
 bool constant_medium::hit(const ray& r, float t_min, float t_max, hit_record& rec) const {
+	PT_STAT(medium_tests);
 	// Print occasional samples when debugging. To enable, set enableDebug true.
 	const bool enableDebug = false;
-	bool debugging = enableDebug && random_double() < 0.00001;
+	bool debugging = enableDebug && random_float() < 0.00001;
 
 	hit_record rec1, rec2;
 
@@ -41,7 +42,7 @@ bool constant_medium::hit(const ray& r, float t_min, float t_max, hit_record& re
 			if (rec1.t < 0) rec1.t = 0; // clamp to frustum
 
 			float distance_inside_boundary = (rec2.t - rec1.t)*r.direction().length();
-			float hit_distance = -(1/density) * log(random_double());
+			float hit_distance = -(1/density) * log(random_float());
 
 			// Inside of volume
 			if (hit_distance < distance_inside_boundary) {
@@ -5,6 +5,7 @@
 #include "../aabb.h"
 #include "../random.h"
 #include "../onb.h"
+#include "../stats.h"
 
 class material;
 
@@ -20,10 +21,12 @@ class hittable {
 	public:
 		// virtual function with "= 0" is pure abstruct function
 		// this has to be implemented and cannot be instanciated
+		// hit() only writes rec when it returns true (BVH traversal relies on it)
 		virtual bool hit(const ray& r, float t_min, float t_max, hit_record& rec) const = 0;
 		virtual bool bounding_box(float t0, float t1, aabb& box) const = 0;
 		virtual float pdf_value(const vec3& o, const vec3& v) const { return 0.0; } // dummy
 		virtual vec3 random(const vec3& o) const { return vec3(1, 0, 0); }          // dummy
+		virtual ~hittable() {}
 };
 
 #endif
@@ -63,7 +63,7 @@ float hittable_list::pdf_value(const vec3& o, const vec3& v) const {
 }
 
 vec3 hittable_list::random(const vec3& o) const {
-	int index = int(random_double() * list_size);
+	int index = int(random_float() * list_size);
 	return list[ index ]->random(o);
 }
 
@@ -0,0 +1,44 @@
+#ifndef INSTANCEH
+#define INSTANCEH
+
+#include "hittable.h"
+#include "../affine.h"
+
+// One placement of shared geometry (bottom level): any hittable, usually a BVH or a mesh with its own BVH
+// The transform and its inverse are computed once; the top-level BVH of build_accelerator
+// sees instances as ordinary objects with a world-space box
+// Rays go to object space unnormalized, so t is the same in both spaces
+class instance : public hittable {
+	public:
+		instance(const hittable *geometry, const affine& object_to_world)
+			: ptr(geometry), to_world(object_to_world), to_object(object_to_world.inverse()) {
+			hasbox = ptr->bounding_box(0, 1, bbox);
+			if (hasbox) bbox = transform_box(to_world, bbox);
+		}
+
+		virtual bool hit(const ray& r, float t_min, float t_max, hit_record& rec) const;
+		virtual bool bounding_box(float t0, float t1, aabb& box) const {
+			box = bbox;
+			return hasbox;
+		}
+
+		const hittable *ptr;
+		affine to_world;
+		affine to_object;
+		bool hasbox;
+		aabb bbox; // world box over the shutter interval [0, 1]
+};
+
+bool instance::hit(const ray& r, float t_min, float t_max, hit_record& rec) const {
+	if (hasbox && !bbox.hit(r, t_min, t_max)) return false;
+	PT_STAT(instance_tests);
+
+	ray local(to_object.point(r.origin()), to_object.vector(r.direction()), r.time());
+	if (!ptr->hit(local, t_min, t_max, rec)) return false;
+
+	rec.p = to_world.point(rec.p);
+	rec.normal = unit_vector(to_object.transposed_vector(rec.normal));
+	return true;
+}
+
+#endif
@@ -26,6 +26,7 @@ vec3 moving_sphere::center(float time) const {
 }
 
 bool moving_sphere::hit(const ray& r, float t_min, float t_max, hit_record& rec) const {
+	PT_STAT(sphere_tests);
 	vec3 co = r.origin() - center(r.time());
 	float a = dot(r.direction(), r.direction());
 	float b = dot(co, r.direction());
@@ -52,6 +52,9 @@ rotate_y::rotate_y(hittable *p, float angle) : ptr(p) {
 }
 
 bool rotate_y::hit(const ray& r, float t_min, float t_max, hit_record& rec) const {
+	// Cheap reject against the rotated box before transforming the ray
+	if (hasbox && !bbox.hit(r, t_min, t_max)) return false;
+
 	// Rotate ray's origin and direction in opposite direction
 
 	vec3 origin = r.origin();
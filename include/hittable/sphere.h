@@ -6,8 +6,8 @@
 void get_sphere_uv(const vec3& p, float& u, float& v);
 
 inline vec3 random_to_sphere(float radius, float distance_squared) {
-	float r1 = random_double();
-	float r2 = random_double();
+	float r1 = random_float();
+	float r2 = random_float();
 	float z = 1 + r2*(sqrt(1-radius*radius/distance_squared) - 1);
 	float phi = 2*M_PI*r1;
 	float x = cos(phi)*sqrt(1-z*z);
@@ -34,6 +34,7 @@ class sphere: public hittable {
 
 // Using namespace to point to the "hit" function in the namespace "sphere"
 bool sphere::hit(const ray& r, float t_min, float t_max, hit_record& rec) const {
+	PT_STAT(sphere_tests);
 	vec3 co = r.origin() - center;
 	float a = dot(r.direction(), r.direction());
 	float b = dot(co, r.direction()); // 2b
@@ -5,18 +5,28 @@
 
 class translate : public hittable {
 	public:
-		translate(hittable *p, const vec3& displacement) : ptr(p), offset(displacement) {}
+		translate(hittable *p, const vec3& displacement) : ptr(p), offset(displacement) {
+			hasbox = ptr->bounding_box(0, 1, bbox);
+			if (hasbox) bbox = aabb(bbox.min() + offset, bbox.max() + offset);
+		}
 
 		virtual bool hit(const ray& r, float t_min, float t_max, hit_record& rec) const;
 		virtual bool bounding_box(float t0, float t1, aabb& box) const;
 
 		hittable *ptr;
 		vec3 offset;
+		bool hasbox;
+		aabb bbox; // moved box over the shutter interval [0, 1]
 };
 
 bool translate::hit(const ray& r, float t_min, float t_max, hit_record& rec) const {
+	// Cheap reject before paying for the wrapped object
+	if (hasbox && !bbox.hit(r, t_min, t_max)) return false;
+
 	// Move ray in opposite direction instead of moving the object
-	ray moved_r(r.origin() - offset, r.direction(), r.time());
+	// (direction is unchanged, so its precomputed inverse is kept)
+	ray moved_r = r;
+	moved_r.A = r.origin() - offset;
 	if (ptr->hit(moved_r, t_min, t_max, rec)) {
 		// Also offset the hit point
 		rec.p += offset;
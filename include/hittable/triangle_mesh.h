@@ -0,0 +1,262 @@
+#ifndef TRIANGLEMESHH
+#define TRIANGLEMESHH
+
+#include <stdint.h>
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include <sys/mman.h>
+
+#include "hittable.h"
+#include "../accel/bvh_builder.h"
+#include "../accel/linear_bvh.h"
+
+// Per-ray setup of the watertight ray-triangle test (Woop, Benthin, Wald 2013)
+// The ray is sheared so it runs along +z; edge functions are then evaluated in 2D,
+// and neighbouring triangles agree exactly on their shared edge, so no ray slips through a mesh
+struct watertight_ray {
+	watertight_ray(const ray& r) {
+		const vec3& d = r.direction();
+		// z axis = largest direction component, x/y keep the winding of the triangles
+		kz = fabs(d[0]) > fabs(d[1]) ? (fabs(d[0]) > fabs(d[2]) ? 0 : 2) : (fabs(d[1]) > fabs(d[2]) ? 1 : 2);
+		kx = kz == 2 ? 0 : kz + 1;
+		ky = kx == 2 ? 0 : kx + 1;
+		if (d[kz] < 0) {
+			int swap = kx;
+			kx = ky;
+			ky = swap;
+		}
+		sx = d[kx] / d[kz];
+		sy = d[ky] / d[kz];
+		sz = 1.0f / d[kz];
+		org = r.origin();
+	}
+
+	int kx, ky, kz;
+	float sx, sy, sz;
+	vec3 org;
+};
+
+// Returns t and the barycentric weights of v0, v1, v2 when the triangle is hit within (t_min, t_max)
+// Both faces are hit, like the rects
+inline bool intersect_triangle(const watertight_ray& wr, const vec3& v0, const vec3& v1, const vec3& v2,
+							   float t_min, float t_max, float& t, float& b0, float& b1, float& b2) {
+	vec3 a = v0 - wr.org;
+	vec3 b = v1 - wr.org;
+	vec3 c = v2 - wr.org;
+
+	float ax = a[wr.kx] - wr.sx * a[wr.kz];
+	float ay = a[wr.ky] - wr.sy * a[wr.kz];
+	float bx = b[wr.kx] - wr.sx * b[wr.kz];
+	float by = b[wr.ky] - wr.sy * b[wr.kz];
+	float cx = c[wr.kx] - wr.sx * c[wr.kz];
+	float cy = c[wr.ky] - wr.sy * c[wr.kz];
+
+	// Scaled barycentrics; an exact zero means the ray is on an edge, redone in double so it is not lost
+	float u = cx * by - cy * bx;
+	float v = ax * cy - ay * cx;
+	float w = bx * ay - by * ax;
+	if (u == 0.0f || v == 0.0f || w == 0.0f) {
+		u = float(double(cx) * by - double(cy) * bx);
+		v = float(double(ax) * cy - double(ay) * cx);
+		w = float(double(bx) * ay - double(by) * ax);
+	}
+
+	if ((u < 0.0f || v < 0.0f || w < 0.0f) && (u > 0.0f || v > 0.0f || w > 0.0f)) return false;
+	float det = u + v + w;
+	if (det == 0.0f) return false;
+
+	float inv_det = 1.0f / det;
+	t = (u * wr.sz * a[wr.kz] + v * wr.sz * b[wr.kz] + w * wr.sz * c[wr.kz]) * inv_det;
+	if (!(t_min < t && t < t_max)) return false;
+
+	b0 = u * inv_det;
+	b1 = v * inv_det;
+	b2 = w * inv_det;
+	return true;
+}
+
+// Arrays the intersection reads, pointing into the mesh's own vectors or into a mapped cache file
+// normals and uvs are null when the mesh has none
+struct triangle_mesh_arrays {
+	triangle_mesh_arrays() { memset(this, 0, sizeof(*this)); }
+
+	const float *px, *py, *pz;
+	const float *nx, *ny, *nz;
+	const float *tu, *tv;
+	const int32_t *indices;
+	const int32_t *normal_indices;
+	const int32_t *uv_indices;
+	const linear_bvh_node *nodes;
+	int32_t n_vertices, n_normals, n_uvs, n_triangles, n_nodes;
+};
+
+// Indexed triangle mesh with its own BVH
+// Vertex attributes are kept as separate arrays (SoA) and each has its own index list, as in OBJ files;
+// triangles are stored in BVH leaf order, so a leaf is a contiguous range of them
+// The vectors are filled by a loader; a mesh mapped from a cache keeps them empty and only sets the arrays
+class triangle_mesh : public hittable {
+	public:
+		triangle_mesh() : mat_ptr(0), mapping(0), mapping_size(0) {}
+		virtual ~triangle_mesh();
+
+		// Sorts the triangles into leaf order and flattens the BVH (call once the vectors are filled)
+		void build(int max_leaf_size = 4);
+		// p -> scale * p + offset for the vertices and the BVH (scale > 0, so boxes stay exact; not for mapped meshes)
+		void place(float scale, const vec3& offset);
+		// Points the arrays at the vectors
+		void use_vectors();
+
+		virtual bool hit(const ray& r, float t_min, float t_max, hit_record& rec) const;
+		virtual bool bounding_box(float t0, float t1, aabb& box) const;
+
+		int triangle_count() const { return a.n_triangles; }
+		int vertex_count() const { return a.n_vertices; }
+		vec3 position(int k) const { return vec3(a.px[k], a.py[k], a.pz[k]); }
+		size_t geometry_bytes() const;
+		size_t bvh_bytes() const { return size_t(a.n_nodes) * sizeof(linear_bvh_node); }
+
+		std::vector<float> px, py, pz;       // positions
+		std::vector<float> nx, ny, nz;       // vertex normals, may be empty
+		std::vector<float> tu, tv;           // texture coordinates, may be empty
+		std::vector<int32_t> indices;        // 3 position indices per triangle
+		std::vector<int32_t> normal_indices; // 3 per triangle, or empty (geometric normal)
+		std::vector<int32_t> uv_indices;     // 3 per triangle, or empty (barycentric u, v)
+		std::vector<linear_bvh_node> nodes;
+		triangle_mesh_arrays a;
+		material *mat_ptr;
+		aabb box;
+		void *mapping;                       // cache file the arrays point into, unmapped with the mesh
+		size_t mapping_size;
+};
+
+// Reorders the index lists to leaf order, 3 entries per triangle
+inline void reorder_triangles(std::vector<int32_t>& list, const std::vector<int>& order) {
+	if (list.empty()) return;
+	std::vector<int32_t> sorted(list.size());
+	for (size_t i = 0; i < order.size(); i++)
+		for (int k = 0; k < 3; k++) sorted[3*i + k] = list[3*order[i] + k];
+	list.swap(sorted);
+}
+
+triangle_mesh::~triangle_mesh() {
+	if (mapping) munmap(mapping, mapping_size);
+}
+
+template <typename T>
+inline const T *array_or_null(const std::vector<T>& v) { return v.empty() ? 0 : &v[0]; }
+
+void triangle_mesh::use_vectors() {
+	a.px = array_or_null(px);
+	a.py = array_or_null(py);
+	a.pz = array_or_null(pz);
+	a.nx = array_or_null(nx);
+	a.ny = array_or_null(ny);
+	a.nz = array_or_null(nz);
+	a.tu = array_or_null(tu);
+	a.tv = array_or_null(tv);
+	a.indices = array_or_null(indices);
+	a.normal_indices = array_or_null(normal_indices);
+	a.uv_indices = array_or_null(uv_indices);
+	a.nodes = array_or_null(nodes);
+	a.n_vertices = int32_t(px.size());
+	a.n_normals = int32_t(nx.size());
+	a.n_uvs = int32_t(tu.size());
+	a.n_triangles = int32_t(indices.size() / 3);
+	a.n_nodes = int32_t(nodes.size());
+}
+
+void triangle_mesh::build(int max_leaf_size) {
+	int n = int(indices.size() / 3);
+	std::vector<aabb> bounds(n);
+	for (int i = 0; i < n; i++) {
+		const int32_t *tri = &indices[3*i];
+		vec3 p0(px[tri[0]], py[tri[0]], pz[tri[0]]), p1(px[tri[1]], py[tri[1]], pz[tri[1]]), p2(px[tri[2]], py[tri[2]], pz[tri[2]]);
+		bounds[i] = aabb(
+						vec3(ffmin(p0[0], ffmin(p1[0], p2[0])), ffmin(p0[1], ffmin(p1[1], p2[1])), ffmin(p0[2], ffmin(p1[2], p2[2]))),
+						vec3(ffmax(p0[0], ffmax(p1[0], p2[0])), ffmax(p0[1], ffmax(p1[1], p2[1])), ffmax(p0[2], ffmax(p1[2], p2[2])))
+					);
+	}
+
+	bvh_builder tree(bounds, max_leaf_size, split_sah);
+	nodes = flatten_bvh(tree);
+	reorder_triangles(indices, tree.prim_order);
+	reorder_triangles(normal_indices, tree.prim_order);
+	reorder_triangles(uv_indices, tree.prim_order);
+	if (tree.root) box = tree.root->bounds;
+	use_vectors();
+}
+
+void triangle_mesh::place(float scale, const vec3& offset) {
+	for (size_t k = 0; k < px.size(); k++) {
+		px[k] = scale * px[k] + offset[0];
+		py[k] = scale * py[k] + offset[1];
+		pz[k] = scale * pz[k] + offset[2];
+	}
+	for (size_t k = 0; k < nodes.size(); k++)
+		nodes[k].bounds = aabb(scale * nodes[k].bounds.min() + offset, scale * nodes[k].bounds.max() + offset);
+	box = aabb(scale * box.min() + offset, scale * box.max() + offset);
+}
+
+size_t triangle_mesh::geometry_bytes() const {
+	return sizeof(float) * (3 * size_t(a.n_vertices) + 3 * size_t(a.n_normals) + 2 * size_t(a.n_uvs))
+		 + sizeof(int32_t) * 3 * size_t(a.n_triangles) * (1 + (a.normal_indices ? 1 : 0) + (a.uv_indices ? 1 : 0));
+}
+
+bool triangle_mesh::hit(const ray& r, float t_min, float t_max, hit_record& rec) const {
+	if (!a.nodes) return false;
+
+	// Only the closest triangle is remembered during traversal, rec is filled once at the end
+	watertight_ray wr(r);
+	int best = -1;
+	float best_t = 0, best_b0 = 0, best_b1 = 0, best_b2 = 0;
+	traverse_bvh(a.nodes, r, t_min, t_max, [&](int i, float& closest) {
+		PT_STAT(triangle_tests);
+		float t, b0, b1, b2;
+		if (!intersect_triangle(wr, position(a.indices[3*i]), position(a.indices[3*i+1]), position(a.indices[3*i+2]),
+								t_min, closest, t, b0, b1, b2))
+			return false;
+		closest = t;
+		best = i;
+		best_t = t;
+		best_b0 = b0;
+		best_b1 = b1;
+		best_b2 = b2;
+		return true;
+	});
+	if (best < 0) return false;
+
+	const int32_t *tri = &a.indices[3*best];
+	vec3 p0 = position(tri[0]), p1 = position(tri[1]), p2 = position(tri[2]);
+	rec.t = best_t;
+	// From the barycentrics instead of the ray, so the point lies on the triangle
+	rec.p = best_b0 * p0 + best_b1 * p1 + best_b2 * p2;
+
+	if (a.normal_indices) {
+		const int32_t *n = &a.normal_indices[3*best];
+		rec.normal = unit_vector(best_b0 * vec3(a.nx[n[0]], a.ny[n[0]], a.nz[n[0]])
+							   + best_b1 * vec3(a.nx[n[1]], a.ny[n[1]], a.nz[n[1]])
+							   + best_b2 * vec3(a.nx[n[2]], a.ny[n[2]], a.nz[n[2]]));
+	}
+	else
+		rec.normal = unit_vector(cross(p1 - p0, p2 - p0)); // counter-clockwise side is the front
+
+	if (a.uv_indices) {
+		const int32_t *uv = &a.uv_indices[3*best];
+		rec.u = best_b0 * a.tu[uv[0]] + best_b1 * a.tu[uv[1]] + best_b2 * a.tu[uv[2]];
+		rec.v = best_b0 * a.tv[uv[0]] + best_b1 * a.tv[uv[1]] + best_b2 * a.tv[uv[2]];
+	}
+	else {
+		rec.u = best_b1;
+		rec.v = best_b2;
+	}
+	rec.mat_ptr = mat_ptr;
+	return true;
+}
+
+bool triangle_mesh::bounding_box(float t0, float t1, aabb& b) const {
+	b = box;
+	return a.nodes != 0;
+}
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef WIDEBVHH
+#define WIDEBVHH
+
+#include <vector>
+
+#include "hittable.h"
+#include "../accel/bvh_builder.h"
+#include "../accel/wide_bvh_node.h"
+
+// BVH with N children per node (N = 4 for SSE, N = 8 for AVX)
+// Built like bvh_node, then the binary tree is collapsed into wide nodes
+template <int N>
+class wide_bvh : public hittable {
+	public:
+		wide_bvh() {}
+		wide_bvh(hittable **l, int n, float time0, float time1, int max_leaf_size = 4);
+
+		virtual bool hit(const ray& r, float tmin, float tmax, hit_record& rec) const;
+		virtual bool bounding_box(float t0, float t1, aabb& box) const;
+
+		std::vector<wide_bvh_node<N> > nodes; // nodes[0] is the root
+		std::vector<hittable*> prims;         // objects in leaf order
+		aabb box;
+};
+
+typedef wide_bvh<4> bvh4;
+typedef wide_bvh<8> bvh8;
+
+template <int N>
+wide_bvh<N>::wide_bvh(hittable **l, int n, float time0, float time1, int max_leaf_size) {
+	std::vector<aabb> bounds(n);
+	for (int i = 0; i < n; i++) {
+		if (!l[i]->bounding_box(time0, time1, bounds[i]))
+			std::cerr << "no bounding box in wide_bvh constructor\n";
+	}
+
+	bvh_builder tree(bounds, max_leaf_size);
+	nodes = collapse_bvh<N>(tree);
+
+	prims.resize(tree.prim_order.size());
+	for (size_t i = 0; i < prims.size(); i++)
+		prims[i] = l[tree.prim_order[i]];
+
+	if (tree.root) box = tree.root->bounds;
+}
+
+template <int N>
+bool wide_bvh<N>::hit(const ray& r, float t_min, float t_max, hit_record& rec) const {
+	if (nodes.empty()) return false;
+
+	return traverse_wide_bvh<N>(&nodes[0], r, t_min, t_max, [&](int i, float& closest) {
+		if (prims[i]->hit(r, t_min, closest, rec)) {
+			closest = rec.t;
+			return true;
+		}
+		return false;
+	});
+}
+
+template <int N>
+bool wide_bvh<N>::bounding_box(float t0, float t1, aabb& b) const {
+	b = box;
+	return !nodes.empty();
+}
+
+#endif
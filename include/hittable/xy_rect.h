@@ -6,21 +6,25 @@
 /* Axis-aligned rectangle */
 class xy_rect: public hittable {
 	public:
-		xy_rect() {}
+		xy_rect() : flipped(false) {}
 		xy_rect(float _x0, float _x1, float _y0, float _y1, float _k, material *mat)
-			: x0(_x0), x1(_x1), y0(_y0), y1(_y1), k(_k), mp(mat) {}; // z = k
+			: x0(_x0), x1(_x1), y0(_y0), y1(_y1), k(_k), mp(mat), flipped(false) {}; // z = k
 
 		virtual bool hit(const ray& r, float t0, float t1, hit_record& rec) const;
 		virtual bool bounding_box(float t0, float t1, aabb& box) const {
 			box =  aabb(vec3(x0,y0, k-0.0001), vec3(x1, y1, k+0.0001));
 			return true;
 		}
+		virtual float  pdf_value(const vec3& o, const vec3& v) const;
+		virtual vec3 random(const vec3& o) const;
 
 		material *mp;
 		float x0, x1, y0, y1, k;
+		bool flipped; // normal points to -z (flip_normals folded in by optimize_scene)
 };
 
 bool xy_rect::hit(const ray& r, float t0, float t1, hit_record& rec) const {
+	PT_STAT(rect_tests);
 	// Get t based on z value
 	// z(t) = az + t * bz
 	// where
@@ -45,9 +49,26 @@ bool xy_rect::hit(const ray& r, float t0, float t1, hit_record& rec) const {
 	rec.t = t;
 	rec.mat_ptr = mp;
 	rec.p = r.point_at_parameter(t);
-	rec.normal = vec3(0, 0, 1);
+	rec.normal = vec3(0, 0, flipped ? -1 : 1);
 
 	return true;
 }
 
+float xy_rect::pdf_value(const vec3& o, const vec3& v) const {
+	hit_record rec;
+	if (this->hit(ray(o, v), 0.001, FLT_MAX, rec)) {
+		float area = (x1-x0)*(y1-y0);
+		float distance_squared = rec.t * rec.t * v.squared_length();
+		float cosine = fabs(dot(v, rec.normal) / v.length());
+		return  distance_squared / (cosine * area);
+	}
+	else return 0;
+}
+
+// Returns a direction from origin to random point in light
+vec3 xy_rect::random(const vec3& o) const {
+	vec3 random_point = vec3(x0 + random_float()*(x1-x0), y0 + random_float()*(y1-y0), k);
+	return random_point - o;
+}
+
 #endif
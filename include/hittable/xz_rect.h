@@ -5,9 +5,9 @@
 
 class xz_rect: public hittable {
 	public:
-		xz_rect() {}
+		xz_rect() : flipped(false) {}
 		xz_rect(float _x0, float _x1, float _z0, float _z1, float _k, material *mat)
-			: x0(_x0), x1(_x1), z0(_z0), z1(_z1), k(_k), mp(mat) {};
+			: x0(_x0), x1(_x1), z0(_z0), z1(_z1), k(_k), mp(mat), flipped(false) {};
 
 		virtual bool hit(const ray& r, float t0, float t1, hit_record& rec) const;
 		virtual bool bounding_box(float t0, float t1, aabb& box) const {
@@ -19,9 +19,11 @@ class xz_rect: public hittable {
 
 		material *mp;
 		float x0, x1, z0, z1, k;
+		bool flipped; // normal points to -y (flip_normals folded in by optimize_scene)
 };
 
 bool xz_rect::hit(const ray& r, float t0, float t1, hit_record& rec) const {
+	PT_STAT(rect_tests);
 	float t = (k-r.origin().y()) / r.direction().y();
 
 	// Out of frustum
@@ -38,7 +40,7 @@ bool xz_rect::hit(const ray& r, float t0, float t1, hit_record& rec) const {
 	rec.t = t;
 	rec.mat_ptr = mp;
 	rec.p = r.point_at_parameter(t);
-	rec.normal = vec3(0, 1, 0);
+	rec.normal = vec3(0, flipped ? -1 : 1, 0);
 
 	return true;
 }
@@ -56,7 +58,7 @@ float xz_rect::pdf_value(const vec3& o, const vec3& v) const {
 
 // Returns a direction from origin to random point in light
 vec3 xz_rect::random(const vec3& o) const {
-	vec3 random_point = vec3(x0 + random_double()*(x1-x0), k, z0 + random_double()*(z1-z0));
+	vec3 random_point = vec3(x0 + random_float()*(x1-x0), k, z0 + random_float()*(z1-z0));
 	return random_point - o;
 }
 
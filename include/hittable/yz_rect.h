@@ -5,19 +5,24 @@
 
 class yz_rect: public hittable {
 	public:
-		yz_rect() {}
+		yz_rect() : flipped(false) {}
 		yz_rect(float _y0, float _y1, float _z0, float _z1, float _k, material *mat)
-			: y0(_y0), y1(_y1), z0(_z0), z1(_z1), k(_k), mp(mat) {};
+			: y0(_y0), y1(_y1), z0(_z0), z1(_z1), k(_k), mp(mat), flipped(false) {};
 		virtual bool hit(const ray& r, float t0, float t1, hit_record& rec) const;
 		virtual bool bounding_box(float t0, float t1, aabb& box) const {
 			box =  aabb(vec3(k-0.0001, y0, z0), vec3(k+0.0001, y1, z1));
 			return true;
 		}
+		virtual float  pdf_value(const vec3& o, const vec3& v) const;
+		virtual vec3 random(const vec3& o) const;
+
 		material  *mp;
 		float y0, y1, z0, z1, k;
+		bool flipped; // normal points to -x (flip_normals folded in by optimize_scene)
 };
 
 bool yz_rect::hit(const ray& r, float t0, float t1, hit_record& rec) const {
+	PT_STAT(rect_tests);
 	float t = (k-r.origin().x()) / r.direction().x();
 
 	// Out of frustum
@@ -34,9 +39,26 @@ bool yz_rect::hit(const ray& r, float t0, float t1, hit_record& rec) const {
 	rec.t = t;
 	rec.mat_ptr = mp;
 	rec.p = r.point_at_parameter(t);
-	rec.normal = vec3(1, 0, 0);
+	rec.normal = vec3(flipped ? -1 : 1, 0, 0);
 
 	return true;
 }
 
+float yz_rect::pdf_value(const vec3& o, const vec3& v) const {
+	hit_record rec;
+	if (this->hit(ray(o, v), 0.001, FLT_MAX, rec)) {
+		float area = (y1-y0)*(z1-z0);
+		float distance_squared = rec.t * rec.t * v.squared_length();
+		float cosine = fabs(dot(v, rec.normal) / v.length());
+		return  distance_squared / (cosine * area);
+	}
+	else return 0;
+}
+
+// Returns a direction from origin to random point in light
+vec3 yz_rect::random(const vec3& o) const {
+	vec3 random_point = vec3(k, y0 + random_float()*(y1-y0), z0 + random_float()*(z1-z0));
+	return random_point - o;
+}
+
 #endif
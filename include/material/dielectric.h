@@ -7,8 +7,9 @@ class dielectric : public material {
 	public:
 		dielectric(float ri) : ref_idx(ri) {}
 		virtual bool scatter(const ray& r_in, const hit_record& hrec, scatter_record& srec) const {
+			PT_STAT(dielectric_scatters);
 			srec.is_specular = true;
-			srec.pdf_ptr = 0;
+			srec.sampling_pdf.reset();
 			srec.attenuation = vec3(1.0, 1.0, 1.0);
 			vec3 outward_normal;
 			vec3 reflected = reflect(r_in.direction(), hrec.normal);
@@ -34,7 +35,7 @@ class dielectric : public material {
 			else reflect_prob = 1.0;
 
 			// Based on the probability, return refracted or reflected ray
-			if (random_double() < reflect_prob) {
+			if (random_float() < reflect_prob) {
 			   srec.specular_ray = ray(hrec.p, reflected);
 			}
 			else {
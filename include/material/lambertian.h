@@ -9,9 +9,10 @@ class lambertian : public material {
 		lambertian(texture *a, bool texture_map=false) : albedo(a), image_texture(texture_map) {}
 
 		virtual bool scatter(const ray& r_in, const hit_record& hrec, scatter_record& srec) const {
+			PT_STAT(lambertian_scatters);
 			srec.is_specular = false;
 			srec.attenuation = albedo->value(hrec.u, hrec.v, hrec.p);
-			srec.pdf_ptr = new cosine_pdf(hrec.normal);
+			srec.sampling_pdf = cosine_pdf(hrec.normal);
 			return true;
 		}
 
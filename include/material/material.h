@@ -3,13 +3,14 @@
 
 #include "../random.h"
 //#include "../vec3.h"
-#include "../pdf/cosine_pdf.h"
+#include "../pdf/pdf_variant.h"
+#include "../stats.h"
 
 struct scatter_record {
 	ray specular_ray;
 	bool is_specular;
 	vec3 attenuation;
-	pdf *pdf_ptr;
+	pdf_variant sampling_pdf; // held by value, so scattering never touches the heap
 };
 
 class material {
@@ -33,7 +34,7 @@ vec3 random_in_unit_sphere() {
 	// Keep getting a random point on a unit sphere until we get one
 	do {
 		// map from [0, 1) to [-1, 1) where -vec3(1,1,1) is offset
-		p = 2.0*vec3(random_double(), random_double(), random_double()) - vec3(1,1,1);
+		p = 2.0*vec3(random_float(), random_float(), random_float()) - vec3(1,1,1);
 	} while (p.squared_length() >= 1.0);
 
 	return p;
@@ -44,7 +45,7 @@ vec3 random_on_unit_sphere() {
 	vec3 p;
 
 	do {
-		p = 2.0*vec3(random_double(), random_double(), random_double()) - vec3(1,1,1);
+		p = 2.0*vec3(random_float(), random_float(), random_float()) - vec3(1,1,1);
 	} while (dot(p,p) >= 1.0);
 	
 	return unit_vector(p);
@@ -10,11 +10,12 @@ class metal : public material {
 		}
 
 		virtual bool scatter(const ray& r_in, const hit_record& hrec, scatter_record& srec) const {
+			PT_STAT(metal_scatters);
 			vec3 reflected = reflect(unit_vector(r_in.direction()), hrec.normal);
 			srec.specular_ray = ray(hrec.p, reflected+fuzz*random_in_unit_sphere());
 			srec.attenuation = albedo;
 			srec.is_specular = true;
-			srec.pdf_ptr = 0; // On metal surface, the light only comes from reflected direction. So don't use cosine pdf
+			srec.sampling_pdf.reset(); // On metal surface, the light only comes from reflected direction. So don't use cosine pdf
 			return true;
 		}
 
@@ -2,6 +2,7 @@
 #define HITTABLEPDFH
 
 #include "pdf.h"
+#include "../hittable/hittable.h"
 
 // Sample directly from lights
 // the hittable obj is the light itself
@@ -10,6 +11,7 @@ class hittable_pdf : public pdf {
 		hittable_pdf(hittable *p, const vec3& origin) : ptr(p), o(origin) {}
 
 		virtual float value(const vec3& direction) const {
+			PT_STAT(light_rays);
 			return ptr->pdf_value(o, direction);
 		}
 
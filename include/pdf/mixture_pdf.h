@@ -12,7 +12,7 @@ class mixture_pdf : public pdf {
 			return 0.5 * p[0]->value(direction) + 0.5 *p[1]->value(direction);
 		}
 		virtual vec3 generate() const {
-			if (random_double() < 0.5) return p[0]->generate();
+			if (random_float() < 0.5) return p[0]->generate();
 			else return p[1]->generate();
 		}
 
@@ -10,8 +10,8 @@ class pdf  {
 };
 
 inline vec3 random_cosine_direction() {
-	float r1 = random_double();
-	float r2 = random_double();
+	float r1 = random_float();
+	float r2 = random_float();
 	float z = sqrt(1-r2);
 	float phi = 2*M_PI*r1;
 	float x = cos(phi)*sqrt(r2);
@@ -0,0 +1,63 @@
+#ifndef PDFVARIANTH
+#define PDFVARIANTH
+
+#include <new>
+
+#include "pdf.h"
+#include "cosine_pdf.h"
+#include "hittable_pdf.h"
+#include "mixture_pdf.h"
+
+// One of the pdfs above, stored by value
+// Materials fill it in scatter_record instead of allocating a pdf per bounce
+class pdf_variant : public pdf {
+	public:
+		enum pdf_type { none_type, cosine_type, hittable_type, mixture_type };
+
+		pdf_variant() : type(none_type) {}
+		pdf_variant(const pdf_variant& other) : type(none_type) { *this = other; }
+
+		pdf_variant& operator=(const pdf_variant& other) {
+			if (this == &other) return *this;
+			switch (other.type) {
+				case cosine_type:   return *this = other.cosine;
+				case hittable_type: return *this = other.light;
+				case mixture_type:  return *this = other.mixture;
+				default:            reset(); return *this;
+			}
+		}
+		pdf_variant& operator=(const cosine_pdf& p)   { type = cosine_type;   new (&cosine) cosine_pdf(p);    return *this; }
+		pdf_variant& operator=(const hittable_pdf& p) { type = hittable_type; new (&light) hittable_pdf(p);   return *this; }
+		pdf_variant& operator=(const mixture_pdf& p)  { type = mixture_type;  new (&mixture) mixture_pdf(p); return *this; }
+
+		void reset() { type = none_type; }
+		bool empty() const { return type == none_type; }
+
+		// Qualified calls are bound statically, so the switch replaces the virtual dispatch
+		virtual float value(const vec3& direction) const {
+			switch (type) {
+				case cosine_type:   return cosine.cosine_pdf::value(direction);
+				case hittable_type: return light.hittable_pdf::value(direction);
+				case mixture_type:  return mixture.mixture_pdf::value(direction);
+				default:            return 0;
+			}
+		}
+
+		virtual vec3 generate() const {
+			switch (type) {
+				case cosine_type:   return cosine.cosine_pdf::generate();
+				case hittable_type: return light.hittable_pdf::generate();
+				case mixture_type:  return mixture.mixture_pdf::generate();
+				default:            return vec3(1, 0, 0);
+			}
+		}
+
+		pdf_type type;
+		union {
+			cosine_pdf cosine;
+			hittable_pdf light;
+			mixture_pdf mixture;
+		};
+};
+
+#endif
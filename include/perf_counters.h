@@ -0,0 +1,260 @@
+#ifndef PERFCOUNTERSH
+#define PERFCOUNTERSH
+
+#include <stdint.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Hardware counters read with perf_event_open (--perf, Linux only)
+// Only user space is counted, which perf_event_paranoid <= 2 allows without privileges
+// Containers and VMs often hide the PMU: then the counters are reported as unavailable and nothing else changes
+enum perf_event_kind {
+	perf_cycles,
+	perf_instructions,
+	perf_l1d_misses,  // L1 data cache read misses
+	perf_llc_misses,  // last level cache read misses
+	perf_branch_misses,
+	perf_event_count
+};
+
+inline const char *perf_event_name(int e) {
+	static const char *names[perf_event_count] = { "cycles", "instructions", "L1D misses", "LLC misses", "branch misses" };
+	return names[e];
+}
+
+// Counter values; a counter that could not be opened stays invalid
+struct perf_sample {
+	perf_sample() { clear(); }
+
+	void clear() {
+		for (int e = 0; e < perf_event_count; e++) {
+			value[e] = 0;
+			valid[e] = false;
+		}
+	}
+
+	perf_sample& operator+=(const perf_sample& o) {
+		for (int e = 0; e < perf_event_count; e++) {
+			value[e] += o.value[e];
+			valid[e] = valid[e] || o.valid[e];
+		}
+		return *this;
+	}
+
+	perf_sample operator-(const perf_sample& o) const {
+		perf_sample d;
+		for (int e = 0; e < perf_event_count; e++) {
+			d.value[e] = value[e] - o.value[e];
+			d.valid[e] = valid[e] && o.valid[e];
+		}
+		return d;
+	}
+
+	uint64_t value[perf_event_count];
+	bool valid[perf_event_count];
+};
+
+// The counters of the calling thread, counting from open() on
+// With inherit, threads started afterwards are added in once they exit (the tile workers are joined after each pass)
+class perf_counter_set {
+	public:
+		perf_counter_set() : error(0) { for (int e = 0; e < perf_event_count; e++) fd[e] = -1; }
+		~perf_counter_set() { close(); }
+
+		bool open(bool inherit);
+		void close();
+		perf_sample read() const;
+
+		int fd[perf_event_count];
+		int error; // errno of the first counter that failed to open
+
+	private:
+		perf_counter_set(const perf_counter_set&);
+		perf_counter_set& operator=(const perf_counter_set&);
+};
+
+#if defined(__linux__)
+bool perf_counter_set::open(bool inherit) {
+	const uint32_t type[perf_event_count] = {
+		PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE
+	};
+	const uint64_t config[perf_event_count] = {
+		PERF_COUNT_HW_CPU_CYCLES,
+		PERF_COUNT_HW_INSTRUCTIONS,
+		PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+		PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+		PERF_COUNT_HW_BRANCH_MISSES
+	};
+
+	bool any = false;
+	for (int e = 0; e < perf_event_count; e++) {
+		perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = type[e];
+		attr.config = config[e];
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.inherit = inherit ? 1 : 0;
+		// Scaled up in read() when the kernel has to multiplex more counters than the PMU has
+		attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+		fd[e] = int(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0)); // this thread, any cpu
+		if (fd[e] < 0 && error == 0) error = errno;
+		any = any || fd[e] >= 0;
+	}
+	return any;
+}
+
+void perf_counter_set::close() {
+	for (int e = 0; e < perf_event_count; e++) {
+		if (fd[e] >= 0) ::close(fd[e]);
+		fd[e] = -1;
+	}
+}
+
+perf_sample perf_counter_set::read() const {
+	perf_sample s;
+	for (int e = 0; e < perf_event_count; e++) {
+		uint64_t buf[3]; // value, time enabled, time running
+		if (fd[e] < 0 || ::read(fd[e], buf, sizeof(buf)) != sizeof(buf)) continue;
+		s.value[e] = buf[2] > 0 && buf[2] < buf[1] ? uint64_t(double(buf[0]) * buf[1] / buf[2]) : buf[0];
+		s.valid[e] = true;
+	}
+	return s;
+}
+#else
+bool perf_counter_set::open(bool inherit) { error = ENOSYS; return false; }
+void perf_counter_set::close() {}
+perf_sample perf_counter_set::read() const { return perf_sample(); }
+#endif
+
+// Counters per named phase (main thread plus its workers) and per tile worker
+struct perf_profile {
+	perf_profile() : enabled(false) {}
+
+	bool enabled;
+	perf_counter_set process;
+	std::vector<std::string> phase_names; // in order of first use, a phase used again adds up
+	std::vector<perf_sample> phases;
+	std::vector<perf_sample> workers;     // indexed by tile_scheduler thread id, summed over passes
+};
+
+inline perf_profile& perf() {
+	static perf_profile profile;
+	return profile;
+}
+
+// Opens the counters; prints why and returns false when there are none
+bool perf_start(int n_workers) {
+	perf_profile& p = perf();
+	if (!p.process.open(true)) {
+		fprintf(stderr, "Hardware counters unavailable (%s), --perf is ignored\n", strerror(p.process.error));
+		return false;
+	}
+	p.enabled = true;
+	p.workers.assign(n_workers, perf_sample());
+	return true;
+}
+
+// Index of a phase, added at its first use
+inline int perf_phase(const char *name) {
+	perf_profile& p = perf();
+	for (size_t k = 0; k < p.phase_names.size(); k++)
+		if (p.phase_names[k] == name) return int(k);
+	p.phase_names.push_back(name);
+	p.phases.push_back(perf_sample());
+	return int(p.phases.size()) - 1;
+}
+
+// Counts the enclosing block into a phase, when --perf is on (phases may nest, e.g. texture load in scene build)
+struct perf_scope {
+	perf_scope(const char *name) : phase(-1) {
+		if (!perf().enabled) return;
+		phase = perf_phase(name);
+		begin = perf().process.read();
+	}
+
+	~perf_scope() {
+		if (phase >= 0) perf().phases[phase] += perf().process.read() - begin;
+	}
+
+	int phase;
+	perf_sample begin;
+};
+
+// Counters of the calling thread only, opened the first time it is asked for
+inline perf_counter_set& thread_perf_counters() {
+	static thread_local perf_counter_set counters;
+	static thread_local bool opened = false;
+	if (!opened) {
+		counters.open(false);
+		opened = true;
+	}
+	return counters;
+}
+
+// Counts the enclosing block into the worker's total (a worker id is used by one thread at a time)
+struct perf_worker_scope {
+	perf_worker_scope(int id) : worker(id) {
+		if (perf().enabled) begin = thread_perf_counters().read();
+	}
+
+	~perf_worker_scope() {
+		if (perf().enabled) perf().workers[worker] += thread_perf_counters().read() - begin;
+	}
+
+	int worker;
+	perf_sample begin;
+};
+
+inline void print_perf_value(const perf_sample& s, int e, double divisor) {
+	if (s.valid[e] && divisor > 0) printf(" %14.3f", s.value[e] / divisor);
+	else if (s.valid[e]) printf(" %14llu", (unsigned long long)s.value[e]);
+	else printf(" %14s", "n/a");
+}
+
+inline void print_perf_row(const char *name, const perf_sample& s, double divisor) {
+	printf("%-18s", name);
+	for (int e = 0; e < perf_event_count; e++) print_perf_value(s, e, divisor);
+	if (s.valid[perf_cycles] && s.valid[perf_instructions] && s.value[perf_cycles] > 0)
+		printf(" %6.2f\n", double(s.value[perf_instructions]) / s.value[perf_cycles]);
+	else
+		printf(" %6s\n", "n/a");
+}
+
+// Phases, workers, and the render phase divided by the number of rays (unit names what was counted)
+void print_perf_report(const char *render_phase, uint64_t rays, const char *unit) {
+	perf_profile& p = perf();
+	if (!p.enabled) return;
+
+	printf("%-18s", "hardware counters");
+	for (int e = 0; e < perf_event_count; e++) printf(" %14s", perf_event_name(e));
+	printf(" %6s\n", "IPC");
+
+	perf_sample render;
+	for (size_t k = 0; k < p.phases.size(); k++) {
+		print_perf_row(p.phase_names[k].c_str(), p.phases[k], 0);
+		if (p.phase_names[k] == render_phase) render = p.phases[k];
+	}
+	for (size_t k = 0; k < p.workers.size(); k++) {
+		char name[32];
+		snprintf(name, sizeof(name), "worker %d", int(k));
+		print_perf_row(name, p.workers[k], 0);
+	}
+
+	char name[32];
+	snprintf(name, sizeof(name), "per %s", unit);
+	print_perf_row(name, render, double(rays));
+}
+
+#endif
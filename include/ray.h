@@ -6,16 +6,27 @@ class ray
 {
 	public:
 		ray() {}
-		ray(const vec3& a, const vec3& b, float ti = 0.0) { A = a; B = b; _time = ti;}
+		ray(const vec3& a, const vec3& b, float ti = 0.0) { A = a; B = b; _time = ti; set_inverse(); }
 
-		vec3 origin()    const { return A; }
-		vec3 direction() const { return B; }
+		const vec3& origin()    const { return A; }
+		const vec3& direction() const { return B; }
+		const vec3& inv_direction() const { return inv_B; }
 		float time()     const { return _time; }
 		vec3 point_at_parameter(float t) const { return A + t * B; }
 
+		// Slab tests multiply by 1/B instead of dividing, and sign[a] says which box corner is hit first
+		void set_inverse() {
+			inv_B = vec3(1.0f / B[0], 1.0f / B[1], 1.0f / B[2]);
+			sign[0] = inv_B[0] < 0;
+			sign[1] = inv_B[1] < 0;
+			sign[2] = inv_B[2] < 0;
+		}
+
 		vec3 A;
 		vec3 B;
+		vec3 inv_B;
 		float _time; // Store the time the ray exists at
+		int sign[3];
 };
 
 #endif
@@ -0,0 +1,134 @@
+#ifndef ACCUMULATIONH
+#define ACCUMULATIONH
+
+#include <stdint.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <unistd.h> // fsync
+
+#include "../vec3.h"
+#include "framebuffer.h"
+
+// Running sum of the samples of one pixel
+// Samples are added one by one in sample order, so the sum does not depend on how the render was split into passes
+struct accum_pixel {
+	accum_pixel() : sum(0, 0, 0), n(0) {}
+
+	vec3 sum;
+	int32_t n;
+};
+
+static_assert(sizeof(accum_pixel) == 16, "accum_pixel is stored as is in checkpoints");
+
+// Everything a resumed render must agree on, followed in the file by nx*ny accum_pixels
+// The sampler is counter based, so its state is just (seed, next sample index = passes_done * pass_spp)
+struct checkpoint_header {
+	char magic[4];       // "PTCK"
+	uint32_t version;
+	int32_t nx, ny;
+	uint64_t seed;
+	int32_t scene;
+	int32_t spp;         // samples per pixel of the finished image
+	int32_t pass_spp;    // samples per pixel added by one pass
+	int32_t passes_done;
+	int32_t max_depth;
+	int32_t rr_depth;
+	int32_t accelerator; // bvh_layout, or -1 for --brute-force
+	int32_t adaptive;    // --adaptive: 1, with min_spp and max_error below (spp is the max); 0 leaves them 0
+	int32_t min_spp;
+	float max_error;
+	uint64_t obj_hash;   // hash_bytes() of the --obj file, 0 without one
+};
+
+const uint32_t checkpoint_version = 3;
+
+class accumulation_buffer {
+	public:
+		accumulation_buffer(int w, int h) : nx(w), ny(h), storage(w*h), pixels(&storage[0]) {}
+
+		// Accumulate into external memory (a mapped framebuffer file) from now on, nx*ny pixels
+		void attach(accum_pixel *external) {
+			pixels = external;
+			std::vector<accum_pixel>().swap(storage);
+		}
+
+		accum_pixel& at(int i, int j) { return pixels[j*nx + i]; }
+		const accum_pixel& at(int i, int j) const { return pixels[j*nx + i]; }
+
+		// Mean of each pixel
+		void resolve(framebuffer& fb) const;
+
+		// Writes path.tmp and renames it over path, so a crash leaves either the old or the new checkpoint
+		bool save_checkpoint(const char *path, const checkpoint_header& header) const;
+		// Fails if the file is missing, broken, or was written for different settings than expected
+		bool load_checkpoint(const char *path, const checkpoint_header& expected, int& passes_done);
+
+		size_t size() const { return size_t(nx) * ny; }
+
+		int nx, ny;
+		std::vector<accum_pixel> storage; // own pixels, empty when attached
+		accum_pixel *pixels;              // row j=0 is the bottom of the image
+};
+
+void accumulation_buffer::resolve(framebuffer& fb) const {
+	for (int j = 0; j < ny; j++) {
+		for (int i = 0; i < nx; i++) {
+			const accum_pixel& px = at(i, j);
+			fb.at(i, j) = px.n > 0 ? px.sum / float(px.n) : vec3(0, 0, 0);
+		}
+	}
+}
+
+bool accumulation_buffer::save_checkpoint(const char *path, const checkpoint_header& header) const {
+	std::string tmp = std::string(path) + ".tmp";
+	FILE *f = fopen(tmp.c_str(), "wb");
+	if (!f) return false;
+
+	bool ok = fwrite(&header, sizeof(header), 1, f) == 1
+		   && fwrite(pixels, sizeof(accum_pixel), size(), f) == size()
+		   && fflush(f) == 0
+		   && fsync(fileno(f)) == 0;
+	ok = (fclose(f) == 0) && ok;
+
+	if (!ok || rename(tmp.c_str(), path) != 0) {
+		remove(tmp.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool accumulation_buffer::load_checkpoint(const char *path, const checkpoint_header& expected, int& passes_done) {
+	FILE *f = fopen(path, "rb");
+	if (!f) return false;
+
+	checkpoint_header header;
+	bool ok = fread(&header, sizeof(header), 1, f) == 1;
+
+	// Every field but the progress has to match
+	checkpoint_header h = header;
+	h.passes_done = expected.passes_done;
+	ok = ok && memcmp(&h, &expected, sizeof(h)) == 0;
+
+	std::vector<accum_pixel> loaded(size());
+	ok = ok && fread(&loaded[0], sizeof(accum_pixel), loaded.size(), f) == loaded.size();
+	fclose(f);
+	if (!ok) return false;
+
+	std::copy(loaded.begin(), loaded.end(), pixels);
+	passes_done = header.passes_done;
+	return true;
+}
+
+// Header of a fresh checkpoint (zero padding, so headers compare with memcmp)
+inline checkpoint_header make_checkpoint_header() {
+	checkpoint_header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "PTCK", 4);
+	header.version = checkpoint_version;
+	return header;
+}
+
+#endif
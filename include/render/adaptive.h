@@ -0,0 +1,66 @@
+#ifndef ADAPTIVEH
+#define ADAPTIVEH
+
+#include <fstream>
+#include <vector>
+
+#include "../vec3.h"
+
+// Settings of the adaptive sampling mode (--adaptive)
+struct adaptive_settings {
+	adaptive_settings() : enabled(false), min_spp(32), max_spp(0), max_error(0.01f) {}
+
+	bool enabled;
+	int min_spp;     // samples taken before a pixel may stop
+	int max_spp;     // 0 = the fixed sample count
+	float max_error; // allowed 95% confidence half width, in gamma (sqrt) space
+};
+
+inline float luminance(const vec3& c) {
+	return 0.2126f * c[0] + 0.7152f * c[1] + 0.0722f * c[2];
+}
+
+// Running mean and variance of the luminance of one pixel (Welford's update)
+struct pixel_estimate {
+	pixel_estimate() : n(0), mean(0), m2(0) {}
+
+	void add(const vec3& c) {
+		double y = luminance(c);
+		n++;
+		double delta = y - mean;
+		mean += delta / n;
+		m2 += delta * (y - mean);
+	}
+
+	double variance() const { return n > 1 ? m2 / (n - 1) : 0; }
+
+	// Half width of the 95% confidence interval of the mean, carried through the sqrt
+	// of the output gamma (d sqrt(L) = dL / 2 sqrt(L)), so dark pixels are judged like they look
+	double error() const {
+		double half_width = 1.96 * sqrt(variance() / n);
+		if (half_width == 0) return 0;
+		if (mean <= 0) return 1e30;
+		return half_width / (2 * sqrt(mean));
+	}
+
+	bool converged(float max_error) const { return n > 1 && error() <= max_error; }
+
+	int n;
+	double mean;
+	double m2;
+};
+
+// Samples per pixel as an ASCII PGM, white = max_spp, top row first
+bool write_spp_image(const char *path, const std::vector<int>& spp, int nx, int ny, int max_spp) {
+	ofstream outfile(path);
+	if (!outfile) return false;
+
+	outfile << "P2\n" << nx << " " << ny << "\n255\n";
+	for (int j = ny-1; j >= 0; j--)
+		for (int i = 0; i < nx; i++)
+			outfile << int(255.99 * spp[j*nx + i] / float(max_spp)) << "\n";
+
+	return bool(outfile);
+}
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef FRAMEBUFFERH
+#define FRAMEBUFFERH
+
+#include <stdint.h>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include "../vec3.h"
+#include "../../libs/stb/stb_image.h"
+#include "../../libs/stb/stb_image_write.h"
+
+// In-memory image of the whole frame
+// Workers fill pixels independently and the file is written once at the end
+class framebuffer {
+	public:
+		framebuffer() : nx(0), ny(0) {}
+		framebuffer(int w, int h) : nx(w), ny(h), pixels(w*h, vec3(0, 0, 0)) {}
+
+		vec3& at(int i, int j) { return pixels[j*nx + i]; }
+		const vec3& at(int i, int j) const { return pixels[j*nx + i]; }
+
+		// Linear radiance, no tonemapping (see tonemap.h for 8-bit output)
+		bool write_pfm(const char *path) const;
+		bool write_hdr(const char *path) const;
+		bool read_pfm(const char *path);
+		bool read_hdr(const char *path);
+		bool read(const char *path); // by extension: .hdr, otherwise PFM
+
+		int nx, ny;
+		std::vector<vec3> pixels; // linear radiance, row j=0 is the bottom of the image
+};
+
+// pixels is written and read as one float array
+static_assert(sizeof(vec3) == 3 * sizeof(float), "vec3 must be 3 packed floats");
+
+inline bool host_is_little_endian() {
+	uint16_t one = 1;
+	return *(unsigned char *)&one == 1;
+}
+
+// PFM stores rows bottom to top like pixels does, so the body is a single write
+// A negative scale marks little-endian data
+bool framebuffer::write_pfm(const char *path) const {
+	ofstream outfile(path, ios::binary);
+	if (!outfile) return false;
+
+	outfile << "PF\n" << nx << " " << ny << "\n" << (host_is_little_endian() ? "-1.0" : "1.0") << "\n";
+	outfile.write((const char *)&pixels[0], pixels.size() * sizeof(vec3));
+
+	return bool(outfile);
+}
+
+// Radiance HDR (RGBE) starts from the top row
+bool framebuffer::write_hdr(const char *path) const {
+	std::vector<float> flipped(pixels.size() * 3);
+	for (int j = 0; j < ny; j++)
+		memcpy(&flipped[size_t(ny-1-j) * nx * 3], &pixels[size_t(j) * nx], nx * sizeof(vec3));
+
+	return stbi_write_hdr(path, nx, ny, 3, &flipped[0]) != 0;
+}
+
+bool framebuffer::read_pfm(const char *path) {
+	ifstream infile(path, ios::binary);
+	if (!infile) return false;
+
+	string magic;
+	int w, h;
+	float scale;
+	infile >> magic >> w >> h >> scale;
+	infile.get(); // single whitespace before the data
+	if (!infile || magic != "PF" || w <= 0 || h <= 0) return false;
+
+	nx = w;
+	ny = h;
+	pixels.assign(size_t(nx) * ny, vec3(0, 0, 0));
+	infile.read((char *)&pixels[0], pixels.size() * sizeof(vec3));
+	if (!infile) return false;
+
+	// Byte swap when the file was written on a machine of the other endianness
+	if ((scale < 0) != host_is_little_endian()) {
+		unsigned char *bytes = (unsigned char *)&pixels[0];
+		for (size_t k = 0; k < pixels.size() * 3; k++) {
+			unsigned char *b = bytes + 4*k;
+			std::swap(b[0], b[3]);
+			std::swap(b[1], b[2]);
+		}
+	}
+	return true;
+}
+
+bool framebuffer::read_hdr(const char *path) {
+	int w, h, n;
+	float *data = stbi_loadf(path, &w, &h, &n, 3);
+	if (!data) return false;
+
+	nx = w;
+	ny = h;
+	pixels.resize(size_t(nx) * ny);
+	for (int j = 0; j < ny; j++) {
+		const float *row = data + size_t(ny-1-j) * nx * 3;
+		for (int i = 0; i < nx; i++) at(i, j) = vec3(row[3*i], row[3*i+1], row[3*i+2]);
+	}
+
+	stbi_image_free(data);
+	return true;
+}
+
+bool framebuffer::read(const char *path) {
+	size_t len = strlen(path);
+	if (len > 4 && strcmp(path + len - 4, ".hdr") == 0) return read_hdr(path);
+	return read_pfm(path);
+}
+
+#endif
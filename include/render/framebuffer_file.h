@@ -0,0 +1,147 @@
+#ifndef FRAMEBUFFERFILEH
+#define FRAMEBUFFERFILEH
+
+#include <stdint.h>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "accumulation.h"
+
+// Layout of a mapped framebuffer file (native byte order):
+//   framebuffer_file_header
+//   uint32 tile bitmap at bitmap_offset: bit t of word t/32 is set once tile t has finished pass pass_count
+//   accum_pixel[width*height] at pixel_offset (page aligned), row 0 is the bottom; pixel = sum / n
+// Other processes may map or read the file while rendering goes on; a pixel being written can be torn
+struct framebuffer_file_header {
+	char magic[4];               // "PTFB"
+	uint32_t version;
+	int32_t width, height;
+	int32_t channels;            // floats of sum per pixel, followed by an int32 sample count
+	int32_t pass_count;          // passes finished
+	int32_t n_passes;            // passes of the whole render
+	int32_t tile_size;
+	int32_t n_tiles;
+	uint32_t bitmap_offset;
+	uint64_t pixel_offset;
+	checkpoint_header settings;  // render settings (passes_done unused), a resume needs the same ones
+};
+
+const uint32_t framebuffer_file_version = 3;
+
+// Accumulation buffer shared through mmap
+class framebuffer_file {
+	public:
+		framebuffer_file() : header(0), bitmap(0), pixels(0), fd(-1), size(0) {}
+		~framebuffer_file() { close(); }
+
+		// Maps path with the layout of expected, which must be filled in except pass_count
+		// Without keep, or for a new file, the file is cleared; with keep, an existing file is kept as is
+		// (resumed = true) and one of another layout or other settings fails, untouched
+		bool open(const char *path, const framebuffer_file_header& expected, bool keep, bool& resumed);
+		void close();
+
+		bool tile_done(int t) const { return (__atomic_load_n(&bitmap[t/32], __ATOMIC_ACQUIRE) >> (t%32)) & 1; }
+		void mark_tile(int t) { __atomic_fetch_or(&bitmap[t/32], 1u << (t%32), __ATOMIC_RELEASE); }
+
+		void finish_pass(); // clears the bitmap, then bumps pass_count and starts writing the pages back
+
+		framebuffer_file_header *header;
+		uint32_t *bitmap;
+		accum_pixel *pixels;
+		int fd;
+		size_t size;
+};
+
+inline framebuffer_file_header make_framebuffer_file_header(int nx, int ny, int n_passes, int tile_size, int n_tiles,
+															const checkpoint_header& settings) {
+	framebuffer_file_header h;
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, "PTFB", 4);
+	h.version = framebuffer_file_version;
+	h.width = nx;
+	h.height = ny;
+	h.channels = 3;
+	h.n_passes = n_passes;
+	h.tile_size = tile_size;
+	h.n_tiles = n_tiles;
+	h.bitmap_offset = sizeof(framebuffer_file_header);
+
+	size_t bitmap_end = h.bitmap_offset + (size_t(n_tiles) + 31) / 32 * 4;
+	h.pixel_offset = (bitmap_end + 4095) / 4096 * 4096;
+	h.settings = settings;
+	return h;
+}
+
+bool framebuffer_file::open(const char *path, const framebuffer_file_header& expected, bool keep, bool& resumed) {
+	close();
+	resumed = false;
+
+	fd = ::open(path, O_RDWR | O_CREAT, 0644);
+	if (fd < 0) return false;
+
+	size = expected.pixel_offset + size_t(expected.width) * expected.height * sizeof(accum_pixel);
+
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		close();
+		return false;
+	}
+	// An empty file is new (open just created it); any other file is only ever resumed with keep
+	bool fresh = !keep || st.st_size == 0;
+	if (!fresh && size_t(st.st_size) != size) {
+		close();
+		return false;
+	}
+	if (fresh) {
+		// Truncating first zeroes everything
+		if (ftruncate(fd, 0) != 0 || ftruncate(fd, size) != 0) {
+			close();
+			return false;
+		}
+	}
+
+	void *p = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (p == MAP_FAILED) {
+		close();
+		return false;
+	}
+	header = (framebuffer_file_header *)p;
+	bitmap = (uint32_t *)((char *)p + expected.bitmap_offset);
+	pixels = (accum_pixel *)((char *)p + expected.pixel_offset);
+
+	if (fresh) {
+		*header = expected;
+		return true;
+	}
+	framebuffer_file_header h = *header;
+	h.pass_count = expected.pass_count;
+	if (memcmp(&h, &expected, sizeof(h)) != 0) {
+		close();
+		return false;
+	}
+	resumed = true;
+	return true;
+}
+
+void framebuffer_file::close() {
+	if (header) munmap(header, size);
+	if (fd >= 0) ::close(fd);
+	header = 0;
+	bitmap = 0;
+	pixels = 0;
+	fd = -1;
+}
+
+// The bitmap is cleared before the new pass_count is published, so it never marks tiles of a pass
+// they have not rendered; a kill in between only redoes tiles whose pixels already have their samples
+void framebuffer_file::finish_pass() {
+	for (int w = 0; w < (header->n_tiles + 31) / 32; w++)
+		__atomic_store_n(&bitmap[w], 0u, __ATOMIC_RELEASE);
+	__atomic_store_n(&header->pass_count, header->pass_count + 1, __ATOMIC_RELEASE);
+	msync(header, size, MS_ASYNC);
+}
+
+#endif
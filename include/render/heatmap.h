@@ -0,0 +1,107 @@
+#ifndef HEATMAPH
+#define HEATMAPH
+
+#include <cfloat>
+#include <string>
+#include <vector>
+
+#include "../camera.h"
+#include "../hittable/hittable.h"
+#include "../sampler.h"
+#include "../stats.h"
+#include "framebuffer.h"
+#include "tile_scheduler.h"
+#include "tonemap.h"
+
+// Traversal cost of the camera rays (--heatmap), to spot badly built regions of the accelerator
+// The cost of a ray is how much this thread's PT_STATS counters grow while it is traced,
+// so it works for any accelerator that reports its nodes (bvh_node, bvh4, bvh8, brute force = 0 nodes)
+struct traversal_cost {
+	traversal_cost(int w, int h) : nx(w), ny(h), nodes(size_t(w) * h, 0.0f), prims(size_t(w) * h, 0.0f) {}
+
+	int nx, ny;
+	std::vector<float> nodes; // BVH nodes visited, average per camera ray
+	std::vector<float> prims; // sphere, rect, box and triangle tests, average per camera ray
+};
+
+inline uint64_t primitive_tests(const ray_stats& s) { return s.sphere_tests + s.rect_tests + s.box_tests + s.triangle_tests; }
+
+// Traces spp camera rays per pixel, the same rays the render uses for its first samples
+void measure_traversal_cost(const hittable *world, camera& cam, int spp, uint64_t seed,
+							tile_scheduler& scheduler, traversal_cost& cost) {
+	int nx = cost.nx, ny = cost.ny;
+	scheduler.run([&](const tile& t, int thread_id) {
+		sampler& smp = thread_sampler();
+		const ray_stats& counters = thread_stats();
+		for (int j = t.y0; j < t.y1; j++) {
+			for (int i = t.x0; i < t.x1; i++) {
+				uint64_t nodes0 = counters.bvh_nodes;
+				uint64_t prims0 = primitive_tests(counters);
+				for (int s = 0; s < spp; s++) {
+					smp.start_sample(seed, j*nx + i, s);
+					float u = float(i + random_float()) / float(nx);
+					float v = float(j + random_float()) / float(ny);
+					hit_record rec;
+					world->hit(cam.get_ray(u, v), 0.001, FLT_MAX, rec);
+				}
+				cost.nodes[j*nx + i] = float(counters.bvh_nodes - nodes0) / spp;
+				cost.prims[j*nx + i] = float(primitive_tests(counters) - prims0) / spp;
+			}
+		}
+	});
+}
+
+// False-colour ramp: black, blue, cyan, green, yellow, red, white for t = 0..1
+inline vec3 heat_color(float t) {
+	static const vec3 ramp[] = {
+		vec3(0, 0, 0), vec3(0, 0, 1), vec3(0, 1, 1), vec3(0, 1, 0), vec3(1, 1, 0), vec3(1, 0, 0), vec3(1, 1, 1)
+	};
+	const int last = sizeof(ramp) / sizeof(ramp[0]) - 1;
+
+	if (!(t > 0.0f)) return ramp[0];
+	if (t >= 1.0f) return ramp[last];
+	float x = t * last;
+	int k = int(x);
+	float f = x - k;
+	return (1.0f - f) * ramp[k] + f * ramp[k+1];
+}
+
+inline float max_value(const std::vector<float>& values) {
+	float m = 0;
+	for (size_t k = 0; k < values.size(); k++) m = ffmax(m, values[k]);
+	return m;
+}
+
+inline float mean_value(const std::vector<float>& values) {
+	double sum = 0;
+	for (size_t k = 0; k < values.size(); k++) sum += values[k];
+	return values.empty() ? 0.0f : float(sum / values.size());
+}
+
+// P6 image of the values mapped onto the ramp, 0..max_value (top row first, like the render)
+bool write_heatmap(const char *path, const std::vector<float>& values, int nx, int ny, float max_value) {
+	std::vector<unsigned char> rgb(size_t(nx) * ny * 3);
+	unsigned char *out = &rgb[0];
+	for (int j = ny-1; j >= 0; j--) {
+		for (int i = 0; i < nx; i++) {
+			vec3 c = heat_color(max_value > 0 ? values[j*nx + i] / max_value : 0.0f);
+			for (int channel = 0; channel < 3; channel++) *out++ = (unsigned char)(255.99 * c[channel]);
+		}
+	}
+	return write_ppm(path, rgb, nx, ny);
+}
+
+// prefix_nodes.ppm and prefix_prims.ppm, each scaled to its own maximum,
+// plus prefix.pfm with the exact averages (red = nodes, green = primitives)
+bool write_traversal_cost(const std::string& prefix, const traversal_cost& cost) {
+	framebuffer fb(cost.nx, cost.ny);
+	for (int j = 0; j < cost.ny; j++)
+		for (int i = 0; i < cost.nx; i++)
+			fb.at(i, j) = vec3(cost.nodes[j*cost.nx + i], cost.prims[j*cost.nx + i], 0);
+
+	return write_heatmap((prefix + "_nodes.ppm").c_str(), cost.nodes, cost.nx, cost.ny, max_value(cost.nodes))
+		&& write_heatmap((prefix + "_prims.ppm").c_str(), cost.prims, cost.nx, cost.ny, max_value(cost.prims))
+		&& fb.write_pfm((prefix + ".pfm").c_str());
+}
+
+#endif
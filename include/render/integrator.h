@@ -0,0 +1,91 @@
+#ifndef INTEGRATORH
+#define INTEGRATORH
+
+#include <cfloat>
+
+#include "../hittable/hittable.h"
+#include "../material/material.h"
+#include "../pdf/hittable_pdf.h"
+#include "../pdf/mixture_pdf.h"
+#include "../stats.h"
+
+// Path tracer written as a loop
+// beta (the path throughput) carries the product of attenuation * pdf ratios of all bounces so far,
+// so a bounce only needs its own hit_record and scatter_record
+class path_integrator {
+	public:
+		path_integrator(hittable *w, hittable *lights, int depth = 50, int rr_depth = 3, bool ambient = false)
+			: world(w), light_shape(lights), max_depth(depth), rr_min_depth(rr_depth), use_ambient(ambient) {}
+
+		vec3 li(const ray& r) const;
+		vec3 background(const ray& r) const;
+
+		hittable *world;
+		hittable *light_shape; // sampled directly on diffuse bounces
+		int max_depth;         // a path scatters at most this many times
+		int rr_min_depth;      // Russian roulette starts after this many bounces
+		bool use_ambient;      // sky color instead of black when nothing is hit
+};
+
+vec3 path_integrator::li(const ray& r_camera) const {
+	vec3 radiance(0, 0, 0);
+	vec3 beta(1, 1, 1);
+	ray r = r_camera;
+	PT_STAT(camera_rays);
+
+	for (int depth = 0; ; depth++) {
+		hit_record hrec;
+		PT_STAT(rays);
+		if (depth > 0) PT_STAT(secondary_rays);
+		if (!world->hit(r, 0.001, FLT_MAX, hrec)) {
+			radiance += beta * background(r);
+			break;
+		}
+
+		radiance += beta * hrec.mat_ptr->emitted(r, hrec, hrec.u, hrec.v, hrec.p);
+
+		scatter_record srec;
+		if (depth >= max_depth || !hrec.mat_ptr->scatter(r, hrec, srec)) break;
+
+		if (srec.is_specular) {
+			// On specular surface, color is only collected from the reflected direction
+			beta *= srec.attenuation;
+			r = srec.specular_ray;
+		} else {
+			hittable_pdf plight(light_shape, hrec.p);
+			mixture_pdf p(&plight, &srec.sampling_pdf);
+			ray scattered = ray(hrec.p, p.generate(), r.time());
+			float pdf_val = p.value(scattered.direction());
+			beta *= srec.attenuation * hrec.mat_ptr->scattering_pdf(r, hrec, scattered) / pdf_val;
+			r = scattered;
+		}
+
+		// Russian roulette: continue with probability ~ throughput and reweight the survivors,
+		// so dim paths stop early while the estimate stays unbiased
+		if (depth + 1 >= rr_min_depth) {
+			float survive = ffmin(ffmax(beta[0], ffmax(beta[1], beta[2])), 0.95f);
+			if (random_float() >= survive) {
+				PT_STAT(rr_kills);
+				break;
+			}
+			beta /= survive;
+		}
+	}
+
+	return radiance;
+}
+
+vec3 path_integrator::background(const ray& r) const {
+	if (!use_ambient) return vec3(0, 0, 0);
+
+	// Sky color is a linear interpolation b/w while & blue
+	vec3 unit_direction = unit_vector(r.direction());
+
+	// t is a mapped y from [-1, 1] to [0, 1]
+	// more accurately, t = 0.5 * (sqrt(2)*unit_direction.y() + 1.0)
+	float t = 0.5 * (unit_direction.y() + 1.0);
+
+	return (1.0-t)*vec3(1.0, 1.0, 1.0) + t*vec3(0.5, 0.7, 1.0);
+}
+
+#endif
@@ -0,0 +1,124 @@
+#ifndef TILESCHEDULERH
+#define TILESCHEDULERH
+
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Pixel range [x0, x1) x [y0, y1) rendered as one unit of work
+struct tile {
+	int x0, y0, x1, y1;
+	int index;
+};
+
+// Double-ended queue of tile indices owned by one worker
+// The owner takes work from the front, idle workers steal from the back
+class work_stealing_queue {
+	public:
+		void push(int t) {
+			std::lock_guard<std::mutex> lock(m);
+			items.push_back(t);
+		}
+
+		bool pop(int& t) {
+			std::lock_guard<std::mutex> lock(m);
+			if (items.empty()) return false;
+			t = items.front();
+			items.pop_front();
+			return true;
+		}
+
+		bool steal(int& t) {
+			std::lock_guard<std::mutex> lock(m);
+			if (items.empty()) return false;
+			t = items.back();
+			items.pop_back();
+			return true;
+		}
+
+		std::deque<int> items;
+		std::mutex m;
+};
+
+// Splits the image into tiles and runs them on a pool of worker threads
+// Tiles are handed out dynamically, so expensive tiles (glass, smoke) do not stall the frame
+class tile_scheduler {
+	public:
+		tile_scheduler(int nx, int ny, int tile_size, int n_threads);
+
+		// render_tile(const tile& t, int thread_id) is called once per tile
+		// run() can be called again for another pass over the same tiles
+		template <typename F>
+		void run(F render_tile);
+
+		void fill_queues();
+
+		int thread_count() const { return int(queues.size()); }
+
+		std::vector<tile> tiles;
+		std::vector<work_stealing_queue> queues;
+};
+
+inline int default_thread_count() {
+	int n = int(std::thread::hardware_concurrency());
+	return n > 0 ? n : 1;
+}
+
+tile_scheduler::tile_scheduler(int nx, int ny, int tile_size, int n_threads) : queues(n_threads > 0 ? n_threads : 1) {
+	// Top rows first, so the image fills in the same order as the old scanline loop
+	for (int y1 = ny; y1 > 0; y1 -= tile_size) {
+		for (int x0 = 0; x0 < nx; x0 += tile_size) {
+			tile t;
+			t.x0 = x0;
+			t.x1 = x0 + tile_size < nx ? x0 + tile_size : nx;
+			t.y0 = y1 - tile_size > 0 ? y1 - tile_size : 0;
+			t.y1 = y1;
+			t.index = int(tiles.size());
+			tiles.push_back(t);
+		}
+	}
+}
+
+void tile_scheduler::fill_queues() {
+	// Give each worker a contiguous run of tiles to start with (neighbouring tiles share cache lines of the scene)
+	int n = int(tiles.size());
+	int workers = thread_count();
+	for (int w = 0; w < workers; w++)
+		for (int t = n*w/workers; t < n*(w+1)/workers; t++)
+			queues[w].push(t);
+}
+
+template <typename F>
+void tile_scheduler::run(F render_tile) {
+	fill_queues();
+	int workers = thread_count();
+
+	auto worker = [&](int id) {
+		int t;
+		for (;;) {
+			if (queues[id].pop(t)) {
+				render_tile(tiles[t], id);
+				continue;
+			}
+
+			// Own queue is empty: steal from the others, starting with the next worker
+			bool stolen = false;
+			for (int k = 1; k < workers && !stolen; k++)
+				stolen = queues[(id + k) % workers].steal(t);
+			// No tiles are added after start, so one empty sweep means we are done
+			if (!stolen) return;
+
+			render_tile(tiles[t], id);
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (int id = 1; id < workers; id++)
+		threads.push_back(std::thread(worker, id));
+	worker(0); // calling thread is worker 0
+	for (size_t k = 0; k < threads.size(); k++)
+		threads[k].join();
+}
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef TONEMAPH
+#define TONEMAPH
+
+#include <cmath>
+#include <fstream>
+#include <vector>
+
+#include "framebuffer.h"
+
+// Display transform applied after rendering: value = scale * radiance^(1/gamma), clamped to [0, 1]
+struct tonemap_settings {
+	tonemap_settings() : scale(1.5f), gamma(2.0f) {}
+
+	float scale;
+	float gamma;
+};
+
+// 8-bit RGB of the framebuffer, top row first
+// Runs on a rendered frame or on one read back from a PFM/HDR file
+std::vector<unsigned char> tonemap(const framebuffer& fb, const tonemap_settings& ts) {
+	std::vector<unsigned char> rgb(size_t(fb.nx) * fb.ny * 3);
+	unsigned char *out = &rgb[0];
+
+	for (int j = fb.ny-1; j >= 0; j--) {
+		for (int i = 0; i < fb.nx; i++) {
+			const vec3& col = fb.at(i, j);
+			for (int channel = 0; channel < 3; channel++) {
+				// gamma correction (brighter color)
+				float v = ts.gamma == 2.0f ? sqrt(col[channel]) : pow(col[channel], 1.0f / ts.gamma);
+				v = ts.scale * v;
+
+				// Clamp color to [0, 1]
+				if (v > 1.0f) v = 1.0f;
+				if (!(v > 0.0f)) v = 0.0f;
+
+				*out++ = (unsigned char)(255.99 * v);
+			}
+		}
+	}
+
+	return rgb;
+}
+
+// Binary PPM (P6) in a single write
+bool write_ppm(const char *path, const std::vector<unsigned char>& rgb, int nx, int ny) {
+	ofstream outfile(path, ios::binary);
+	if (!outfile) return false;
+
+	outfile << "P6\n" << nx << " " << ny << "\n255\n";
+	outfile.write((const char *)&rgb[0], rgb.size());
+
+	return bool(outfile);
+}
+
+#endif
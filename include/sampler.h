@@ -0,0 +1,83 @@
+#ifndef SAMPLERH
+#define SAMPLERH
+
+#include <stdint.h>
+
+// PCG32 generator (O'Neill, "PCG: A Family of Simple Fast Space-Efficient Statistically Good Algorithms")
+// 64-bit LCG state with a permuted 32-bit output: 16 bytes of state and no indirect calls
+class pcg32 {
+	public:
+		// Default state is PCG32_INITIALIZER from the reference implementation
+		pcg32() : state(0x853c49e6748fea9bULL), inc(0xda3e39cb94b95bdbULL) {}
+		pcg32(uint64_t initstate, uint64_t initseq = 1) { seed(initstate, initseq); }
+
+		// initseq picks one of 2^63 independent streams
+		void seed(uint64_t initstate, uint64_t initseq = 1) {
+			state = 0;
+			inc = (initseq << 1u) | 1u;
+			next_uint();
+			state += initstate;
+			next_uint();
+		}
+
+		uint32_t next_uint() {
+			uint64_t old = state;
+			state = old * 6364136223846793005ULL + inc;
+			uint32_t xorshifted = uint32_t(((old >> 18u) ^ old) >> 27u);
+			uint32_t rot = uint32_t(old >> 59u);
+			return (xorshifted >> rot) | (xorshifted << ((~rot + 1u) & 31));
+		}
+
+		// Top 24 bits, so the result is exactly representable and always < 1
+		float next_float() { return (next_uint() >> 8) * (1.0f / 16777216.0f); } // [0, 1)
+
+		uint64_t state;
+		uint64_t inc;
+};
+
+// SplitMix64 finalizer: a bijective 64-bit mix with full avalanche
+inline uint64_t mix64(uint64_t z) {
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+// Source of random numbers for rendering
+// - Sequential mode: a plain PCG32 stream (scene construction, tools)
+// - Counter mode: every value is a hash of (seed, pixel, sample index, dimension),
+//   so a sample gets the same numbers no matter which thread renders it or in which order
+class sampler {
+	public:
+		sampler() : counter_mode(false), key(0), dimension(0) {}
+
+		void seed(uint64_t s, uint64_t stream = 1) {
+			counter_mode = false;
+			gen.seed(s, stream);
+		}
+
+		void start_sample(uint64_t s, uint32_t pixel, uint32_t sample_index) {
+			counter_mode = true;
+			key = mix64(s ^ mix64((uint64_t(pixel) << 32) | sample_index));
+			dimension = 0;
+		}
+
+		float next_1d() {
+			if (!counter_mode) return gen.next_float();
+			// Weyl step by the golden ratio keeps consecutive dimensions far apart before mixing
+			uint64_t h = mix64(key + (dimension++) * 0x9e3779b97f4a7c15ULL);
+			return uint32_t(h >> 40) * (1.0f / 16777216.0f); // [0, 1)
+		}
+
+		pcg32 gen;
+		bool counter_mode;
+		uint64_t key;
+		uint32_t dimension;
+};
+
+// Each thread owns its sampler, so there is nothing to lock and nothing shared between workers
+inline sampler& thread_sampler() {
+	thread_local sampler s;
+	return s;
+}
+
+#endif
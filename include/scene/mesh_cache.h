@@ -0,0 +1,283 @@
+#ifndef MESHCACHEH
+#define MESHCACHEH
+
+#include <stdint.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "obj_loader.h"
+#include "../trace.h"
+
+// Binary cache of an OBJ mesh (file.obj.ptcache): the arrays and the flattened BVH of the placed mesh
+// A valid cache is mapped read-only and the mesh reads straight from the mapping, so neither parsing nor
+// the BVH build runs again; the pages are only read in as rays touch them
+//
+// Layout (native byte order):
+//   mesh_cache_header
+//   sections at offsets from the start of the file, 64-byte aligned, offset 0 = absent:
+//   px, py, pz, nx, ny, nz, tu, tv (float), indices, normal_indices, uv_indices (int32), nodes (linear_bvh_node)
+// A cache belongs to one source file and one placement: the content hash, size and placement must match,
+// as must the version and the node layout, otherwise it is rebuilt
+enum mesh_cache_section {
+	cache_px, cache_py, cache_pz, cache_nx, cache_ny, cache_nz, cache_tu, cache_tv,
+	cache_indices, cache_normal_indices, cache_uv_indices, cache_nodes, cache_section_count
+};
+
+struct mesh_cache_header {
+	char magic[4];          // "PTMC"
+	uint32_t version;
+	uint32_t byte_order;    // 0x01020304 as written
+	uint32_t node_size;     // sizeof(linear_bvh_node)
+	uint64_t source_hash;   // hash_bytes() of the OBJ file
+	uint64_t source_size;
+	float placement[4];     // floor and size given to fit_mesh
+	float box_min[3], box_max[3];
+	int32_t n_vertices, n_normals, n_uvs, n_triangles, n_nodes;
+	int32_t pad;
+	uint64_t offset[cache_section_count];
+	uint64_t bytes[cache_section_count];
+};
+
+const uint32_t mesh_cache_version = 1;
+const uint64_t mesh_cache_align = 64;
+
+inline uint64_t rotl64(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+inline uint64_t fmix64(uint64_t k) {
+	k ^= k >> 33;
+	k *= 0xff51afd7ed558ccdULL;
+	k ^= k >> 33;
+	k *= 0xc4ceb9fe1a85ec53ULL;
+	k ^= k >> 33;
+	return k;
+}
+
+// 64-bit content hash, 8 bytes per step (one lane of MurmurHash3 x64), fast enough to run on every start
+inline uint64_t hash_bytes(const char *data, size_t n) {
+	uint64_t h = 0x9e3779b97f4a7c15ULL;
+	size_t k = 0;
+	for (; k + 8 <= n; k += 8) {
+		uint64_t w;
+		memcpy(&w, data + k, 8);
+		w *= 0x87c37b91114253d5ULL;
+		w = rotl64(w, 31);
+		w *= 0x4cf5ad432745937fULL;
+		h ^= w;
+		h = rotl64(h, 27) * 5 + 0x52dce729;
+	}
+	uint64_t tail = 0;
+	memcpy(&tail, data + k, n - k);
+	h ^= fmix64(tail + 1);
+	return fmix64(h ^ n);
+}
+
+// Hash and size of a file; false when it cannot be read
+bool hash_file(const char *path, uint64_t& hash, uint64_t& size) {
+	int fd = open(path, O_RDONLY);
+	struct stat st;
+	if (fd < 0 || fstat(fd, &st) != 0) {
+		if (fd >= 0) close(fd);
+		return false;
+	}
+	size = uint64_t(st.st_size);
+	if (size == 0) {
+		close(fd);
+		hash = hash_bytes("", 0);
+		return true;
+	}
+	void *p = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED) return false;
+	madvise(p, size, MADV_SEQUENTIAL);
+	hash = hash_bytes((const char *)p, size);
+	munmap(p, size);
+	return true;
+}
+
+// Size of one element of a section
+inline size_t mesh_cache_element(int section) {
+	if (section <= cache_tv) return sizeof(float);
+	if (section == cache_nodes) return sizeof(linear_bvh_node);
+	return sizeof(int32_t);
+}
+
+// Expected bytes of each section for the counts of a header
+inline uint64_t mesh_cache_bytes(const mesh_cache_header& h, int section) {
+	uint64_t n = 0;
+	switch (section) {
+		case cache_px: case cache_py: case cache_pz: n = h.n_vertices; break;
+		case cache_nx: case cache_ny: case cache_nz: n = h.n_normals; break;
+		case cache_tu: case cache_tv: n = h.n_uvs; break;
+		case cache_indices: n = 3 * uint64_t(h.n_triangles); break;
+		case cache_normal_indices: n = h.offset[section] ? 3 * uint64_t(h.n_triangles) : 0; break;
+		case cache_uv_indices: n = h.offset[section] ? 3 * uint64_t(h.n_triangles) : 0; break;
+		case cache_nodes: n = h.n_nodes; break;
+	}
+	return n * mesh_cache_element(section);
+}
+
+// Header for the mesh's arrays (and the source file), with the section offsets laid out
+mesh_cache_header make_mesh_cache_header(const triangle_mesh& mesh, uint64_t source_hash, uint64_t source_size,
+										 const float placement[4]) {
+	mesh_cache_header h;
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, "PTMC", 4);
+	h.version = mesh_cache_version;
+	h.byte_order = 0x01020304;
+	h.node_size = sizeof(linear_bvh_node);
+	h.source_hash = source_hash;
+	h.source_size = source_size;
+	memcpy(h.placement, placement, sizeof(h.placement));
+	for (int k = 0; k < 3; k++) {
+		h.box_min[k] = mesh.box.min()[k];
+		h.box_max[k] = mesh.box.max()[k];
+	}
+	h.n_vertices = mesh.a.n_vertices;
+	h.n_normals = mesh.a.n_normals;
+	h.n_uvs = mesh.a.n_uvs;
+	h.n_triangles = mesh.a.n_triangles;
+	h.n_nodes = mesh.a.n_nodes;
+
+	const void *data[cache_section_count] = {
+		mesh.a.px, mesh.a.py, mesh.a.pz, mesh.a.nx, mesh.a.ny, mesh.a.nz, mesh.a.tu, mesh.a.tv,
+		mesh.a.indices, mesh.a.normal_indices, mesh.a.uv_indices, mesh.a.nodes
+	};
+	uint64_t end = (sizeof(h) + mesh_cache_align - 1) / mesh_cache_align * mesh_cache_align;
+	for (int k = 0; k < cache_section_count; k++) {
+		if (!data[k]) continue;
+		h.offset[k] = end;
+		h.bytes[k] = mesh_cache_bytes(h, k);
+		end = (end + h.bytes[k] + mesh_cache_align - 1) / mesh_cache_align * mesh_cache_align;
+	}
+	return h;
+}
+
+// Writes the cache next to path (through a temporary file, so a reader never sees half of it)
+// The temporary file gets a unique name, so renders loading the same OBJ at once never write into each other's
+bool write_mesh_cache(const char *path, const triangle_mesh& mesh, uint64_t source_hash, uint64_t source_size,
+					  const float placement[4]) {
+	mesh_cache_header h = make_mesh_cache_header(mesh, source_hash, source_size, placement);
+	const void *data[cache_section_count] = {
+		mesh.a.px, mesh.a.py, mesh.a.pz, mesh.a.nx, mesh.a.ny, mesh.a.nz, mesh.a.tu, mesh.a.tv,
+		mesh.a.indices, mesh.a.normal_indices, mesh.a.uv_indices, mesh.a.nodes
+	};
+
+	std::string tmp = std::string(path) + ".XXXXXX";
+	int fd = mkstemp(&tmp[0]);
+	if (fd < 0) return false;
+	FILE *f = fchmod(fd, 0644) == 0 ? fdopen(fd, "wb") : 0;
+	if (!f) {
+		close(fd);
+		remove(tmp.c_str());
+		return false;
+	}
+	bool ok = fwrite(&h, sizeof(h), 1, f) == 1;
+	static const char zeros[mesh_cache_align] = { 0 };
+	uint64_t at = sizeof(h);
+	for (int k = 0; k < cache_section_count && ok; k++) {
+		if (!h.offset[k]) continue;
+		ok = fwrite(zeros, 1, h.offset[k] - at, f) == h.offset[k] - at
+		  && (h.bytes[k] == 0 || fwrite(data[k], h.bytes[k], 1, f) == 1);
+		at = h.offset[k] + h.bytes[k];
+	}
+	ok = fclose(f) == 0 && ok;
+	if (ok) ok = rename(tmp.c_str(), path) == 0;
+	if (!ok) remove(tmp.c_str());
+	return ok;
+}
+
+// The mesh of a valid cache, reading from the mapped file; null when there is none or it does not match
+triangle_mesh *map_mesh_cache(const char *path, uint64_t source_hash, uint64_t source_size, const float placement[4],
+							  material *m) {
+	int fd = open(path, O_RDONLY);
+	struct stat st;
+	if (fd < 0 || fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(mesh_cache_header)) {
+		if (fd >= 0) close(fd);
+		return 0;
+	}
+	size_t size = size_t(st.st_size);
+	void *p = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED) return 0;
+
+	const char *base = (const char *)p;
+	const mesh_cache_header& h = *(const mesh_cache_header *)p;
+	bool ok = memcmp(h.magic, "PTMC", 4) == 0 && h.version == mesh_cache_version && h.byte_order == 0x01020304
+		   && h.node_size == sizeof(linear_bvh_node) && h.source_hash == source_hash && h.source_size == source_size
+		   && memcmp(h.placement, placement, sizeof(h.placement)) == 0
+		   && h.n_vertices > 0 && h.n_triangles > 0 && h.n_nodes > 0 && h.n_normals >= 0 && h.n_uvs >= 0
+		   && h.offset[cache_px] && h.offset[cache_indices] && h.offset[cache_nodes];
+	for (int k = 0; k < cache_section_count && ok; k++) {
+		if (!h.offset[k]) continue;
+		ok = h.offset[k] % mesh_cache_align == 0 && h.bytes[k] == mesh_cache_bytes(h, k)
+		  && h.offset[k] <= size && h.bytes[k] <= size - h.offset[k];
+	}
+	if (!ok) {
+		munmap(p, size);
+		return 0;
+	}
+
+	triangle_mesh *mesh = new triangle_mesh();
+	triangle_mesh_arrays& a = mesh->a;
+	const float **floats[] = { &a.px, &a.py, &a.pz, &a.nx, &a.ny, &a.nz, &a.tu, &a.tv };
+	for (int k = cache_px; k <= cache_tv; k++)
+		*floats[k] = h.offset[k] ? (const float *)(base + h.offset[k]) : 0;
+	a.indices = (const int32_t *)(base + h.offset[cache_indices]);
+	a.normal_indices = h.offset[cache_normal_indices] ? (const int32_t *)(base + h.offset[cache_normal_indices]) : 0;
+	a.uv_indices = h.offset[cache_uv_indices] ? (const int32_t *)(base + h.offset[cache_uv_indices]) : 0;
+	a.nodes = (const linear_bvh_node *)(base + h.offset[cache_nodes]);
+	a.n_vertices = h.n_vertices;
+	a.n_normals = h.n_normals;
+	a.n_uvs = h.n_uvs;
+	a.n_triangles = h.n_triangles;
+	a.n_nodes = h.n_nodes;
+	mesh->box = aabb(vec3(h.box_min[0], h.box_min[1], h.box_min[2]), vec3(h.box_max[0], h.box_max[1], h.box_max[2]));
+	mesh->mat_ptr = m;
+	mesh->mapping = p;
+	mesh->mapping_size = size;
+	return mesh;
+}
+
+// load_obj + fit_mesh, through path.ptcache: mapped when it is valid for this file and placement, else rebuilt
+triangle_mesh *load_obj_cached(const char *path, material *m, const vec3& floor, float size, bool use_cache) {
+	typedef std::chrono::steady_clock clock_type;
+	clock_type::time_point start = clock_type::now();
+	uint64_t hash = 0, source_size = 0;
+	if (use_cache && hash_file(path, hash, source_size)) {
+		std::string cache = std::string(path) + ".ptcache";
+		const float placement[4] = { floor[0], floor[1], floor[2], size };
+		triangle_mesh *mesh;
+		{
+			trace_scope event("map_mesh_cache", "io", path);
+			mesh = map_mesh_cache(cache.c_str(), hash, source_size, placement, m);
+		}
+		if (mesh) {
+			// The time includes hashing the OBJ file, which is most of it
+			printf("Mapped %s in %.1f ms\n", cache.c_str(), std::chrono::duration<double, std::milli>(clock_type::now() - start).count());
+			report_mesh(cache.c_str(), *mesh);
+			return mesh;
+		}
+
+		mesh = load_obj(path, m);
+		if (!mesh) return 0;
+		fit_mesh(*mesh, floor, size);
+		if (write_mesh_cache(cache.c_str(), *mesh, hash, source_size, placement))
+			printf("Wrote mesh cache %s\n", cache.c_str());
+		else
+			fprintf(stderr, "Failed to write mesh cache %s\n", cache.c_str());
+		return mesh;
+	}
+
+	triangle_mesh *mesh = load_obj(path, m);
+	if (mesh) fit_mesh(*mesh, floor, size);
+	return mesh;
+}
+
+#endif
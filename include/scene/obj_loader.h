@@ -0,0 +1,420 @@
+#ifndef OBJLOADERH
+#define OBJLOADERH
+
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../hittable/triangle_mesh.h"
+
+// Wavefront OBJ: v, vt, vn and f records (polygons are split into a fan of triangles)
+// Groups, objects, smoothing groups and materials are skipped, the whole file is one mesh
+//
+// The file is mapped and cut into line-aligned chunks that are parsed in parallel, twice:
+// the first pass only counts records, so every array is allocated once at its final size,
+// and the second pass writes each chunk's records straight into its slice of the arrays
+
+inline bool obj_space(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+inline bool obj_digit(char c) { return c >= '0' && c <= '9'; }
+
+inline void skip_obj_space(const char *&s, const char *end) {
+	while (s < end && obj_space(*s)) s++;
+}
+
+// v * 10^e
+inline double obj_scale10(double v, int e) {
+	static const double pow10[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+	if (e < -400) return 0.0;
+	if (e > 400) e = 400;
+	for (; e > 22; e -= 22) v *= 1e22;
+	for (; e < -22; e += 22) v /= 1e22;
+	return e < 0 ? v / pow10[-e] : v * pow10[e];
+}
+
+// Decimal float ("-1.5", ".25", "3e-2") in [s, end), s is moved past it
+// The first 19 significant digits are kept in an integer and scaled once, plenty for a float
+inline bool parse_obj_float(const char *&s, const char *end, float& out) {
+	const char *p = s;
+	bool negative = p < end && *p == '-';
+	if (p < end && (*p == '-' || *p == '+')) p++;
+
+	uint64_t mantissa = 0;
+	int digits = 0, exponent = 0;
+	bool any = false;
+	for (; p < end && obj_digit(*p); p++) {
+		any = true;
+		if (digits < 19) {
+			mantissa = 10 * mantissa + (*p - '0');
+			if (mantissa) digits++;
+		}
+		else exponent++;
+	}
+	if (p < end && *p == '.') {
+		for (p++; p < end && obj_digit(*p); p++) {
+			any = true;
+			if (digits < 19) {
+				mantissa = 10 * mantissa + (*p - '0');
+				if (mantissa) digits++;
+				exponent--;
+			}
+		}
+	}
+	if (!any) return false;
+
+	if (p < end && (*p == 'e' || *p == 'E')) {
+		p++;
+		bool negative_exponent = p < end && *p == '-';
+		if (p < end && (*p == '-' || *p == '+')) p++;
+		if (p == end || !obj_digit(*p)) return false;
+		int e = 0;
+		for (; p < end && obj_digit(*p); p++)
+			if (e < 10000) e = 10 * e + (*p - '0');
+		exponent += negative_exponent ? -e : e;
+	}
+
+	double v = obj_scale10(double(mantissa), exponent);
+	out = float(negative ? -v : v);
+	s = p;
+	return true;
+}
+
+inline bool parse_obj_int(const char *&s, const char *end, int64_t& out) {
+	const char *p = s;
+	bool negative = p < end && *p == '-';
+	if (p < end && (*p == '-' || *p == '+')) p++;
+	if (p == end || !obj_digit(*p)) return false;
+	int64_t v = 0;
+	for (; p < end && obj_digit(*p); p++)
+		if (v < (int64_t(1) << 40)) v = 10 * v + (*p - '0');
+	out = negative ? -v : v;
+	s = p;
+	return true;
+}
+
+// n floats separated by spaces; more values (w, vertex colours) are ignored
+inline bool parse_obj_floats(const char *s, const char *end, int n, float *out) {
+	for (int k = 0; k < n; k++) {
+		skip_obj_space(s, end);
+		if (!parse_obj_float(s, end, out[k])) return false;
+		if (s < end && !obj_space(*s)) return false;
+	}
+	return true;
+}
+
+enum obj_record { obj_other, obj_position, obj_uv, obj_normal, obj_face };
+
+// Kind of the line [s, end), s is moved to its first value
+inline obj_record obj_line_kind(const char *&s, const char *end) {
+	skip_obj_space(s, end);
+	if (end - s < 2) return obj_other;
+	if (s[0] == 'v' && obj_space(s[1])) { s += 2; return obj_position; }
+	if (s[0] == 'f' && obj_space(s[1])) { s += 2; return obj_face; }
+	if (end - s >= 3 && s[0] == 'v' && obj_space(s[2])) {
+		if (s[1] == 't') { s += 3; return obj_uv; }
+		if (s[1] == 'n') { s += 3; return obj_normal; }
+	}
+	return obj_other;
+}
+
+// Corners of a face line, counted as space-separated tokens
+inline int count_obj_corners(const char *s, const char *end) {
+	int n = 0;
+	for (;;) {
+		skip_obj_space(s, end);
+		if (s == end) return n;
+		n++;
+		while (s < end && !obj_space(*s)) s++;
+	}
+}
+
+// Records of each kind, in a chunk or before a point of the file
+struct obj_counts {
+	obj_counts() : positions(0), uvs(0), normals(0), triangles(0) {}
+
+	int64_t positions, uvs, normals, triangles;
+};
+
+// One face corner "v", "v/vt", "v//vn" or "v/vt/vn", s is moved past it
+// OBJ indices start at 1 and count back from the records read so far when negative; missing parts are -1,
+// and an index that does not point into the records read so far fails the corner
+inline bool parse_obj_corner(const char *&s, const char *end, const obj_counts& seen, int32_t corner[3]) {
+	const int64_t counts[3] = { seen.positions, seen.uvs, seen.normals };
+	corner[0] = corner[1] = corner[2] = -1;
+	for (int k = 0; k < 3; k++) {
+		if (s < end && *s != '/') {
+			int64_t index;
+			if (!parse_obj_int(s, end, index)) return false;
+			index = index < 0 ? counts[k] + index : index - 1;
+			if (index < 0 || index >= counts[k]) return false;
+			corner[k] = int32_t(index);
+		}
+		if (s == end || *s != '/') break;
+		s++;
+	}
+	return corner[0] >= 0 && (s == end || obj_space(*s));
+}
+
+// Line-aligned slice of the file
+struct obj_chunk {
+	obj_chunk(const char *b, const char *e) : begin(b), end(e), broken(0) {}
+
+	const char *begin, *end;
+	obj_counts count; // records in the chunk (first pass)
+	obj_counts first; // records before the chunk
+	int broken;
+};
+
+// First pass: a face counts as corners-2 triangles, whether it parses or not
+void count_obj_chunk(obj_chunk& chunk) {
+	for (const char *line = chunk.begin; line < chunk.end; ) {
+		const char *eol = (const char *)memchr(line, '\n', chunk.end - line);
+		if (!eol) eol = chunk.end;
+		const char *s = line;
+		switch (obj_line_kind(s, eol)) {
+			case obj_position: chunk.count.positions++; break;
+			case obj_uv: chunk.count.uvs++; break;
+			case obj_normal: chunk.count.normals++; break;
+			case obj_face: {
+				int corners = count_obj_corners(s, eol);
+				if (corners >= 3) chunk.count.triangles += corners - 2;
+				break;
+			}
+			default: break;
+		}
+		line = eol + 1;
+	}
+}
+
+// Second pass: the records go to their final slots; a broken face keeps its slots, marked with -1
+void fill_obj_chunk(obj_chunk& chunk, triangle_mesh& mesh) {
+	obj_counts at = chunk.first;
+	bool uvs = !mesh.uv_indices.empty(), normals = !mesh.normal_indices.empty();
+	for (const char *line = chunk.begin; line < chunk.end; ) {
+		const char *eol = (const char *)memchr(line, '\n', chunk.end - line);
+		if (!eol) eol = chunk.end;
+		const char *s = line;
+		float v[3] = { 0, 0, 0 };
+		switch (obj_line_kind(s, eol)) {
+			case obj_position:
+				if (!parse_obj_floats(s, eol, 3, v)) chunk.broken++;
+				mesh.px[at.positions] = v[0];
+				mesh.py[at.positions] = v[1];
+				mesh.pz[at.positions] = v[2];
+				at.positions++;
+				break;
+			case obj_uv:
+				if (!parse_obj_floats(s, eol, 2, v)) chunk.broken++;
+				mesh.tu[at.uvs] = v[0];
+				mesh.tv[at.uvs] = v[1];
+				at.uvs++;
+				break;
+			case obj_normal:
+				if (!parse_obj_floats(s, eol, 3, v)) chunk.broken++;
+				mesh.nx[at.normals] = v[0];
+				mesh.ny[at.normals] = v[1];
+				mesh.nz[at.normals] = v[2];
+				at.normals++;
+				break;
+			case obj_face: {
+				int corners = count_obj_corners(s, eol);
+				if (corners < 3) {
+					chunk.broken++;
+					break;
+				}
+				int64_t first_triangle = at.triangles;
+				int32_t first[3], prev[3], corner[3];
+				bool ok = true;
+				for (int k = 0; k < corners && ok; k++) {
+					skip_obj_space(s, eol);
+					ok = parse_obj_corner(s, eol, at, corner);
+					if (k == 0) memcpy(first, corner, sizeof(first));
+					else if (k >= 2 && ok) {
+						const int32_t *fan[3] = { first, prev, corner };
+						for (int c = 0; c < 3; c++) {
+							size_t slot = size_t(3 * at.triangles + c);
+							mesh.indices[slot] = fan[c][0];
+							if (uvs) mesh.uv_indices[slot] = fan[c][1];
+							if (normals) mesh.normal_indices[slot] = fan[c][2];
+						}
+						at.triangles++;
+					}
+					memcpy(prev, corner, sizeof(prev));
+				}
+				if (!ok) {
+					chunk.broken++;
+					for (at.triangles = first_triangle; at.triangles < first_triangle + corners - 2; at.triangles++)
+						mesh.indices[size_t(3 * at.triangles)] = -1;
+				}
+				break;
+			}
+			default: break;
+		}
+		line = eol + 1;
+	}
+}
+
+// body(k) for every chunk k, on n_threads threads (the calling thread is one of them)
+template <typename F>
+void parallel_chunks(int n_chunks, int n_threads, F body) {
+	std::atomic<int> next(0);
+	auto worker = [&]() {
+		for (int k = next++; k < n_chunks; k = next++) body(k);
+	};
+	std::vector<std::thread> threads;
+	for (int t = 1; t < n_threads; t++) threads.push_back(std::thread(worker));
+	worker();
+	for (size_t t = 0; t < threads.size(); t++) threads[t].join();
+}
+
+// Drops an attribute's index list when a corner has none (-1)
+inline void drop_partial_attribute(std::vector<int32_t>& indices) {
+	for (size_t k = 0; k < indices.size(); k++) {
+		if (indices[k] < 0) {
+			std::vector<int32_t>().swap(indices);
+			return;
+		}
+	}
+}
+
+// Removes the triangles of broken faces, then the attributes that not every corner has
+void finish_obj_indices(triangle_mesh& mesh) {
+	size_t n = mesh.indices.size() / 3, kept = 0;
+	bool uvs = !mesh.uv_indices.empty(), normals = !mesh.normal_indices.empty();
+	for (size_t i = 0; i < n; i++) {
+		if (mesh.indices[3*i] < 0) continue;
+		for (int c = 0; c < 3; c++) {
+			mesh.indices[3*kept + c] = mesh.indices[3*i + c];
+			if (uvs) mesh.uv_indices[3*kept + c] = mesh.uv_indices[3*i + c];
+			if (normals) mesh.normal_indices[3*kept + c] = mesh.normal_indices[3*i + c];
+		}
+		kept++;
+	}
+	if (kept < n) {
+		mesh.indices.resize(3 * kept);
+		if (uvs) mesh.uv_indices.resize(3 * kept);
+		if (normals) mesh.normal_indices.resize(3 * kept);
+	}
+	drop_partial_attribute(mesh.uv_indices);
+	drop_partial_attribute(mesh.normal_indices);
+}
+
+// Prints the size of the mesh and its memory per triangle
+void report_mesh(const char *path, const triangle_mesh& mesh) {
+	double n = mesh.triangle_count() > 0 ? mesh.triangle_count() : 1;
+	printf("Loaded %s: %d vertices, %d triangles, %.1f bytes/triangle (geometry %.1f, BVH %.1f, %d nodes)\n",
+		   path, mesh.vertex_count(), mesh.triangle_count(),
+		   (mesh.geometry_bytes() + mesh.bvh_bytes()) / n, mesh.geometry_bytes() / n, mesh.bvh_bytes() / n,
+		   mesh.a.n_nodes);
+}
+
+// Reads the file into a mesh and builds its BVH; null when the file cannot be read or has no triangles
+// n_threads <= 0 uses every hardware thread
+triangle_mesh *load_obj(const char *path, material *m, int n_threads = 0) {
+	typedef std::chrono::steady_clock clock_type;
+	clock_type::time_point start = clock_type::now();
+
+	int fd = open(path, O_RDONLY);
+	struct stat st;
+	if (fd < 0 || fstat(fd, &st) != 0 || st.st_size == 0) {
+		fprintf(stderr, "Failed to open %s\n", path);
+		if (fd >= 0) close(fd);
+		return 0;
+	}
+	size_t size = size_t(st.st_size);
+	void *mapped = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (mapped == MAP_FAILED) {
+		fprintf(stderr, "Failed to map %s\n", path);
+		return 0;
+	}
+	madvise(mapped, size, MADV_SEQUENTIAL);
+	const char *data = (const char *)mapped, *data_end = data + size;
+
+	// A few chunks per thread even out the load; small files are not worth a thread
+	if (n_threads <= 0) n_threads = std::max(1, int(std::thread::hardware_concurrency()));
+	int n_split = size < (1 << 20) ? 1 : 4 * n_threads;
+	std::vector<obj_chunk> chunks;
+	for (const char *begin = data; begin < data_end; ) {
+		const char *end = data + size * (chunks.size() + 1) / n_split;
+		if (end < begin) end = begin;
+		const char *eol = (const char *)memchr(end, '\n', data_end - end);
+		end = eol ? eol + 1 : data_end;
+		chunks.push_back(obj_chunk(begin, end));
+		begin = end;
+	}
+	int n_chunks = int(chunks.size());
+	n_threads = std::min(n_threads, n_chunks);
+
+	parallel_chunks(n_chunks, n_threads, [&](int k) { count_obj_chunk(chunks[k]); });
+
+	obj_counts total;
+	for (int k = 0; k < n_chunks; k++) {
+		chunks[k].first = total;
+		total.positions += chunks[k].count.positions;
+		total.uvs += chunks[k].count.uvs;
+		total.normals += chunks[k].count.normals;
+		total.triangles += chunks[k].count.triangles;
+	}
+	if (total.positions > INT32_MAX || total.uvs > INT32_MAX || total.normals > INT32_MAX || 3 * total.triangles > INT32_MAX) {
+		fprintf(stderr, "%s is too large for 32-bit indices\n", path);
+		munmap(mapped, size);
+		return 0;
+	}
+
+	triangle_mesh *mesh = new triangle_mesh();
+	mesh->mat_ptr = m;
+	mesh->px.resize(total.positions);
+	mesh->py.resize(total.positions);
+	mesh->pz.resize(total.positions);
+	mesh->tu.resize(total.uvs);
+	mesh->tv.resize(total.uvs);
+	mesh->nx.resize(total.normals);
+	mesh->ny.resize(total.normals);
+	mesh->nz.resize(total.normals);
+	mesh->indices.resize(3 * total.triangles);
+	if (total.uvs > 0) mesh->uv_indices.resize(3 * total.triangles);
+	if (total.normals > 0) mesh->normal_indices.resize(3 * total.triangles);
+
+	parallel_chunks(n_chunks, n_threads, [&](int k) { fill_obj_chunk(chunks[k], *mesh); });
+	munmap(mapped, size);
+
+	int broken = 0;
+	for (int k = 0; k < n_chunks; k++) broken += chunks[k].broken;
+	if (broken > 0) fprintf(stderr, "%s: %d broken records skipped\n", path, broken);
+	finish_obj_indices(*mesh);
+	if (mesh->indices.empty()) {
+		fprintf(stderr, "No triangles in %s\n", path);
+		delete mesh;
+		return 0;
+	}
+
+	clock_type::time_point parsed = clock_type::now();
+	mesh->build();
+	printf("Parsed %s (%.1f MB) in %.3f s on %d threads, BVH built in %.3f s\n", path, size / 1048576.0,
+		   std::chrono::duration<double>(parsed - start).count(), n_threads,
+		   std::chrono::duration<double>(clock_type::now() - parsed).count());
+	report_mesh(path, *mesh);
+	return mesh;
+}
+
+// Scales and moves the mesh so its largest side is size and it stands centered on floor
+void fit_mesh(triangle_mesh& mesh, const vec3& floor, float size) {
+	vec3 extent = mesh.box.max() - mesh.box.min();
+	float largest = ffmax(extent[0], ffmax(extent[1], extent[2]));
+	float scale = largest > 0 ? size / largest : 1.0f;
+	vec3 center = 0.5f * (mesh.box.min() + mesh.box.max());
+	mesh.place(scale, floor - scale * vec3(center[0], mesh.box.min()[1], center[2]));
+}
+
+#endif
@@ -0,0 +1,126 @@
+#ifndef SCENEOPTIMIZERH
+#define SCENEOPTIMIZERH
+
+#include <cstdio>
+#include <map>
+
+#include "../hittable/hittable_list.h"
+#include "../hittable/xy_rect.h"
+#include "../hittable/xz_rect.h"
+#include "../hittable/yz_rect.h"
+#include "../hittable/flip_normals.h"
+#include "../hittable/translate.h"
+#include "../hittable/rotate_y.h"
+#include "../hittable/instance.h"
+#include "../hittable/constant_medium.h"
+#include "../accel/accelerator.h"
+#include "../trace.h"
+
+// Flattens the wrapper chains the scene builders leave behind, before the accelerator is built:
+//   flip_normals(rect)                   -> the rect with its flipped flag set
+//   translate/rotate_y/instance, nested  -> one instance with the product of the transforms
+// Lists, BVHs and medium boundaries are walked and their objects replaced in place
+// Wrapped objects are copied rather than changed, in case a builder uses one twice,
+// and an object reached twice (geometry shared by instances) is optimized once and stays shared
+struct scene_optimizer {
+	scene_optimizer() : folded_flips(0), converted_transforms(0), merged_transforms(0) {}
+
+	hittable *optimize(hittable *h);
+	hittable *optimize_object(hittable *h);
+	hittable *fold_flip(flip_normals *f);
+	hittable *merge_transform(hittable *inner, const affine& outer);
+
+	int folded_flips;         // flip_normals wrappers removed
+	int converted_transforms; // translate and rotate_y wrappers turned into instances
+	int merged_transforms;    // nested instances merged into their parent
+	std::map<hittable*, hittable*> done;
+};
+
+// A copy of the rect facing the other way, or null when h is not a rect
+template <typename R>
+hittable *flipped_copy(hittable *h) {
+	R *rect = dynamic_cast<R*>(h);
+	if (!rect) return 0;
+	R *copy = new R(*rect);
+	copy->flipped = !copy->flipped;
+	return copy;
+}
+
+hittable *scene_optimizer::fold_flip(flip_normals *f) {
+	hittable *inner = optimize(f->ptr);
+	hittable *folded = flipped_copy<xy_rect>(inner);
+	if (!folded) folded = flipped_copy<xz_rect>(inner);
+	if (!folded) folded = flipped_copy<yz_rect>(inner);
+	if (folded) {
+		folded_flips++;
+		return folded;
+	}
+	f->ptr = inner;
+	return f;
+}
+
+// outer applied on top of inner (already optimized): nested instances become one
+hittable *scene_optimizer::merge_transform(hittable *inner, const affine& outer) {
+	if (instance *i = dynamic_cast<instance*>(inner)) {
+		merged_transforms++;
+		return new instance(i->ptr, outer * i->to_world);
+	}
+	return new instance(inner, outer);
+}
+
+hittable *scene_optimizer::optimize(hittable *h) {
+	std::map<hittable*, hittable*>::iterator it = done.find(h);
+	if (it != done.end()) return it->second;
+	hittable *result = optimize_object(h);
+	done[h] = result;
+	return result;
+}
+
+hittable *scene_optimizer::optimize_object(hittable *h) {
+	if (hittable_list *hl = dynamic_cast<hittable_list*>(h)) {
+		for (int i = 0; i < hl->list_size; i++) hl->list[i] = optimize(hl->list[i]);
+		return h;
+	}
+	if (std::vector<hittable*> *inner = bvh_objects(h)) {
+		// Replacements have the same boxes, so the BVH stays valid
+		for (size_t i = 0; i < inner->size(); i++) (*inner)[i] = optimize((*inner)[i]);
+		return h;
+	}
+	if (flip_normals *f = dynamic_cast<flip_normals*>(h)) return fold_flip(f);
+	if (translate *t = dynamic_cast<translate*>(h)) {
+		converted_transforms++;
+		return merge_transform(optimize(t->ptr), translation(t->offset));
+	}
+	if (rotate_y *ry = dynamic_cast<rotate_y*>(h)) {
+		affine rotation;
+		rotation.m[0][0] = ry->cos_theta;
+		rotation.m[0][2] = ry->sin_theta;
+		rotation.m[2][0] = -ry->sin_theta;
+		rotation.m[2][2] = ry->cos_theta;
+		converted_transforms++;
+		return merge_transform(optimize(ry->ptr), rotation);
+	}
+	if (instance *i = dynamic_cast<instance*>(h)) {
+		hittable *inner = optimize(const_cast<hittable*>(i->ptr));
+		if (dynamic_cast<instance*>(inner)) return merge_transform(inner, i->to_world);
+		if (inner == i->ptr) return h;
+		return new instance(inner, i->to_world);
+	}
+	if (constant_medium *m = dynamic_cast<constant_medium*>(h)) {
+		m->boundary = optimize(m->boundary);
+		return h;
+	}
+	return h;
+}
+
+// Runs the optimizer over the world and prints what it removed
+hittable *optimize_scene(hittable *world) {
+	trace_scope scope("optimize_scene", "bvh");
+	scene_optimizer opt;
+	world = opt.optimize(world);
+	printf("Scene optimizer: %d flip_normals folded, %d translate/rotate_y turned into instances, %d nested transforms merged\n",
+		   opt.folded_flips, opt.converted_transforms, opt.merged_transforms);
+	return world;
+}
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef SCENEREGISTRYH
+#define SCENEREGISTRYH
+
+#include <cstring>
+
+#include "../camera.h"
+#include "scenes.h"
+
+// Everything main needs to render a built-in scene by name
+struct scene_desc {
+	const char *name;
+	hittable *(*build)();
+	camera (*make_camera)(int nx, int ny);
+	hittable *(*make_light)(); // shape sampled directly by the integrator
+	int width, height;         // default resolution
+	bool use_ambient;          // sky color instead of black background
+	bool texture_map;          // image textures are used
+};
+
+camera outdoor_camera(int nx, int ny) {
+	vec3 lookfrom(13,2,3);
+	vec3 lookat(0,0,0);
+	float dist_to_focus = 10.0;
+	float aperture = 0.0;
+	float vfov = 20.0;
+	return camera(lookfrom, lookat, vec3(0,1,0), vfov, float(nx)/float(ny), aperture, dist_to_focus, 0.0, 1.0);
+}
+
+camera zoomin_camera(int nx, int ny) {
+	vec3 lookfrom(3,3,2);
+	vec3 lookat(0,0,-1);
+	float dist_to_focus = (lookfrom-lookat).length();
+	float aperture = 0.0;
+	float vfov = 20.0;
+	return camera(lookfrom, lookat, vec3(0,1,0), vfov, float(nx)/float(ny), aperture, dist_to_focus, 0.0, 1.0);
+}
+
+camera cornell_camera(int nx, int ny) {
+	vec3 lookfrom(278, 278, -800);
+	vec3 lookat(278,278,0);
+	float dist_to_focus = 10.0;
+	float aperture = 0.0;
+	float vfov = 40.0;
+	return camera(lookfrom, lookat, vec3(0,1,0), vfov, float(nx)/float(ny), aperture, dist_to_focus, 0.0, 1.0);
+}
+
+// Light shapes match the emitters of the scenes (no material needed, they are only sampled)
+// Scenes lit by the sky keep the Cornell box light, as before
+hittable *cornell_light() { return new xz_rect(213, 343, 227, 332, 554, 0); }
+hittable *smoke_light() { return new xz_rect(113, 443, 127, 432, 554, 0); }
+hittable *final_light() { return new xz_rect(123, 423, 147, 412, 554, 0); }
+hittable *simple_light_light() { return new xy_rect(3, 5, 1, 3, -2, 0); }
+
+const scene_desc scene_registry[] = {
+	{ "random",                random_scene,           outdoor_camera, cornell_light,      500, 300, true,  false },
+	{ "moving_spheres_zoomin", moving_spheres_zoomin,  zoomin_camera,  cornell_light,      500, 300, true,  false },
+	{ "two_spheres",           two_spheres,            outdoor_camera, cornell_light,      500, 300, true,  false },
+	{ "two_perlin_spheres",    two_perlin_spheres,     outdoor_camera, cornell_light,      500, 300, true,  false },
+	{ "image_texture",         image_textured_spheres, outdoor_camera, cornell_light,      500, 300, true,  true  },
+	{ "simple_light",          simple_light,           outdoor_camera, simple_light_light, 500, 300, false, false },
+	{ "cornell_box",           cornell_box,            cornell_camera, cornell_light,      500, 500, false, false },
+	{ "cornell_smoke",         cornell_smoke,          cornell_camera, smoke_light,        300, 300, false, false },
+	{ "final",                 final,                  cornell_camera, final_light,        300, 300, false, true  },
+	{ "cornell_mesh",          cornell_mesh,           cornell_camera, cornell_light,      500, 500, false, false },
+	{ "mesh_instances",        mesh_instances,         cornell_camera, cornell_light,      500, 500, false, false }
+};
+
+const int scene_count = sizeof(scene_registry) / sizeof(scene_registry[0]);
+
+// Index into scene_registry, or -1
+inline int find_scene(const char *name) {
+	for (int k = 0; k < scene_count; k++)
+		if (strcmp(scene_registry[k].name, name) == 0) return k;
+	return -1;
+}
+
+// Builds the objects of a scene (builders read texture_map)
+hittable *build_scene(const scene_desc& desc) {
+	trace_scope scope(desc.name, "scene");
+	texture_map = desc.texture_map;
+	return desc.build();
+}
+
+#endif
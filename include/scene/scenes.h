@@ -0,0 +1,470 @@
+#ifndef SCENESH
+#define SCENESH
+
+#include "../hittable/hittable_list.h"
+#include "../hittable/sphere.h"
+#include "../hittable/moving_sphere.h"
+#include "../hittable/xy_rect.h"
+#include "../hittable/yz_rect.h"
+#include "../hittable/xz_rect.h"
+#include "../hittable/flip_normals.h"
+#include "../hittable/box.h"
+#include "../hittable/translate.h"
+#include "../hittable/rotate_y.h"
+#include "../hittable/instance.h"
+#include "../hittable/constant_medium.h"
+#include "../hittable/triangle_mesh.h"
+#include "../accel/accelerator.h"
+
+#include "../material/diffuse_light.h"
+#include "../material/dielectric.h"
+#include "../material/isotropic.h"
+#include "../material/lambertian.h"
+#include "../material/metal.h"
+
+#include "../random.h"
+
+#include "../texture/constant_texture.h"
+#include "../texture/checker_texture.h"
+#include "../texture/noise_texture.h"
+#include "../texture/image_texture.h"
+
+#include "../../libs/stb/stb_image.h"
+#include "../perf_counters.h"
+#include "../trace.h"
+#include "mesh_cache.h"
+
+// Built-in scenes (textures are loaded relative to the src directory)
+// Set by the scene registry before a builder runs
+bool texture_map;
+// Mesh placed in cornell_mesh() (--obj), through its .ptcache file unless --no-mesh-cache
+const char *obj_file = 0;
+bool use_mesh_cache = true;
+
+// stbi_load, counted as the "texture load" phase of --perf and traced with the file name
+unsigned char *load_texture(const char *path, int *nx, int *ny, int *nn) {
+	perf_scope scope("texture load");
+	trace_scope event("stbi_load", "texture", path);
+	return stbi_load(path, nx, ny, nn, 0);
+}
+
+hittable *random_scene() {
+	int n = 8; // Only use mulptiole of 4
+	int arr_size = pow(4, n/4)+4;
+	hittable **list = new hittable*[arr_size];
+
+	// Checker ground
+	texture *checker = new checker_texture(
+    						new constant_texture(vec3(0.2, 0.3, 0.1)),
+    						new constant_texture(vec3(0.9, 0.9, 0.9)));
+	list[0] = new sphere(vec3(0,-1000,0), 1000, new lambertian(checker));
+
+	// Plane ground
+	//list[0] =  new sphere(vec3(0,-1000,0), 1000, new lambertian(new constant_texture(vec3(0.5, 0.5, 0.5))));
+	
+	int i = 1;
+	for (int a = -n/4; a < n/4; a++) {
+		for (int b = -n/4; b < n/4; b++) {
+			float choose_mat = random_float();
+			vec3 center(a+2.5*random_float(),0.2,b+2.5*random_float());
+
+			if ((center-vec3(4,0.2,0)).length() > 0.9) {
+				if (choose_mat < 0.8) {  // diffuse
+					list[i++] = new moving_sphere(
+						center,
+						center+vec3(0, 0.5*random_float(), 0),
+						0.0, 1.0, 0.2,
+						new lambertian(new constant_texture(
+							vec3(random_float()*random_float(),
+								random_float()*random_float(),
+								random_float()*random_float())
+						))
+					);
+				}
+				else if (choose_mat < 0.95) { // metal
+					list[i++] = new sphere(center, 0.2,
+							new metal(vec3(0.5*(1 + random_float()),
+										   0.5*(1 + random_float()),
+										   0.5*(1 + random_float())),
+									  0.5*random_float()));
+				}
+				else {  // glass
+					list[i++] = new sphere(center, 0.2, new dielectric(1.5));
+				}
+			}
+		}
+	}
+
+	list[i++] = new sphere(vec3(0, 1, 0), 1.0, new dielectric(1.5));
+	list[i++] = new sphere(vec3(-4, 1, 0), 1.0, new lambertian(new constant_texture(vec3(0.4, 0.2, 0.1))));
+	list[i++] = new sphere(vec3(4, 1, 0), 1.0, new metal(vec3(0.7, 0.6, 0.5), 0.0));
+
+	return new hittable_list(list,i);
+}
+
+hittable *moving_spheres_zoomin() {
+	hittable **list = new hittable*[4];
+	list[0] = new moving_sphere(vec3(0,0,-1), vec3(0,0,-1)+vec3(0, 0.5*random_float(), 0), 0.0, 1.0, 0.2,
+									new lambertian(new constant_texture(
+											vec3(random_float()*random_float(),
+											random_float()*random_float(),
+											random_float()*random_float())
+										))
+					);
+	list[1] = new moving_sphere(vec3(1,0,-1), vec3(1,0,-1)+vec3(0, 0.5*random_float(), 0), 0.0, 1.0, 0.2,
+									new lambertian(new constant_texture(
+											vec3(random_float()*random_float(),
+											random_float()*random_float(),
+											random_float()*random_float())
+										))
+					);
+	list[2] = new moving_sphere(vec3(-1,0,-1), vec3(-1,0,-1)+vec3(0, 0.5*random_float(), 0), 0.0, 1.0, 0.2,
+									new lambertian(new constant_texture(
+											vec3(random_float()*random_float(),
+											random_float()*random_float(),
+											random_float()*random_float())
+										))
+					);
+	list[3] = new sphere(vec3(0,-100.5,-1), 100, new lambertian(new constant_texture(vec3(0.5, 0.5, 0.5))));
+	return new hittable_list(list, 4);
+}
+
+hittable *two_spheres() {
+	texture *checker = new checker_texture(
+		new constant_texture(vec3(0.2, 0.3, 0.1)),
+		new constant_texture(vec3(0.9, 0.9, 0.9))
+	);
+
+	hittable **list = new hittable*[2];
+	list[0] = new sphere(vec3(0,-10, 0), 10, new lambertian(checker));
+	list[1] = new sphere(vec3(0, 10, 0), 10, new lambertian(checker));
+
+	return new hittable_list(list, 2);
+}
+
+hittable *two_perlin_spheres() {
+	texture *pertext = new noise_texture(4);
+	hittable **list = new hittable*[2];
+	list[0] = new sphere(vec3(0,-1000, 0), 1000, new lambertian(pertext));
+	list[1] = new sphere(vec3(0, 2, 0), 2, new lambertian(pertext));
+	return new hittable_list(list, 2);
+}
+
+hittable *image_textured_spheres() {
+	int nx, ny, nn;
+	unsigned char *tex_data = load_texture("../texture_img/earthmap.jpg", &nx, &ny, &nn);
+	material *mat = new lambertian(new image_texture(tex_data, nx, ny), texture_map);
+
+	texture *pertext = new noise_texture(4);
+	hittable **list = new hittable*[2];
+	list[0] = new sphere(vec3(0,-1000, 0), 1000, new lambertian(pertext));
+	list[1] = new sphere(vec3(0, 2, 0), 2, mat);
+	return new hittable_list(list, 2);
+}
+
+hittable *simple_light() {
+	texture *pertext = new noise_texture(4);
+	hittable **list = new hittable*[4];
+	list[0] = new sphere(vec3(0,-1000, 0), 1000, new lambertian(pertext));
+	list[1] = new sphere(vec3(0, 2, 0), 2, new lambertian(pertext));
+	list[2] = new sphere(vec3(0, 7, 0), 2, new diffuse_light(new constant_texture(vec3(4,4,4))));
+    list[3] = new xy_rect(3, 5, 1, 3, -2, new diffuse_light(new constant_texture(vec3(4,4,4))));
+	return new hittable_list(list,4);
+}
+
+hittable *cornell_box() {
+	hittable **list = new hittable*[11];
+	int i = 0;
+	material *red = new lambertian(new constant_texture(vec3(0.65, 0.05, 0.05)));
+	material *white = new lambertian(new constant_texture(vec3(0.73, 0.73, 0.73)));
+	material *green = new lambertian(new constant_texture(vec3(0.12, 0.45, 0.15)));
+	material *yellow = new lambertian(new constant_texture(vec3(1.0, 0.96, 0.31)));
+	material *light = new diffuse_light(new constant_texture(vec3(15, 15, 15)));
+
+	material *turbtext = new lambertian(new noise_texture(0.1));
+	material *pertext = new lambertian(new noise_texture_perlin(0.1));
+
+	// Warm light
+	//material *light = new diffuse_light(new constant_texture(vec3(16.86 + 5.0, 8.76+2.0 + 5.0, 3.2+0.5 + 5.0)));
+
+	list[i++] = new flip_normals(new yz_rect(0, 555, 0, 555, 555, green));
+	list[i++] = new yz_rect(0, 555, 0, 555, 0, red);
+	list[i++] = new flip_normals(new xz_rect(213, 343, 227, 332, 554, light));
+	list[i++] = new flip_normals(new xz_rect(0, 555, 0, 555, 555, white));
+	list[i++] = new xz_rect(0, 555, 0, 555, 0, white);
+	//list[i++] = new flip_normals(new xy_rect(0, 555, 0, 555, 555, white));
+
+
+	////////////// Last shot /////////////////
+	int nx, ny, nn;
+	unsigned char *tex_data = load_texture("../texture_img/thankyou.jpg", &nx, &ny, &nn);
+	material *img_mat = new lambertian(new image_texture(tex_data, nx, ny), texture_map);
+	list[i++] = new flip_normals(new xy_rect(0, 555, 0, 555, 555, img_mat));
+
+	tex_data = load_texture("../texture_img/bunny.jpg", &nx, &ny, &nn);
+	img_mat = new lambertian(new image_texture(tex_data, nx, ny), texture_map);
+	list[i++] = new instance(new box(vec3(0,0,0), vec3(120,120,120), img_mat),
+							 translation(vec3(130,0,200)) * rotation_y(-18));
+
+
+	// Two boxes in the room
+	/*
+	// Small box
+	list[i++] = new translate(
+					new rotate_y(new box(vec3(0,0,0), vec3(165,165,165), white), -18),
+					vec3(130,0,65));
+	// Tall box
+	list[i++] = new translate(
+					new rotate_y(new box(vec3(0, 0, 0), vec3(165, 330, 165), white),  15),
+					vec3(265,0,295));
+	*/
+
+
+	////////////// All textures /////////////////
+	/*
+	material *turbtext = new lambertian(new noise_texture(0.1));
+	material *pertext = new lambertian(new noise_texture_perlin(0.1));
+
+	// Checker tall box
+	texture *checker = new checker_texture(
+		new constant_texture(vec3(0.2, 0.3, 0.1)),
+		new constant_texture(vec3(0.9, 0.9, 0.9))
+	);
+	list[i++] = new translate(
+					new rotate_y(new box(vec3(0, 0, 0), vec3(165, 330, 165), new lambertian(checker)),  15),
+					vec3(265,0,295));
+
+	// Image textured medium box
+	int nx, ny, nn;
+	unsigned char *tex_data = stbi_load("../texture_img/trojans_flip.png", &nx, &ny, &nn, 0);
+	material *img_mat = new lambertian(new image_texture(tex_data, nx, ny), texture_map);
+	list[i++] = new translate(
+					new rotate_y(new box(vec3(0,0,0), vec3(165,165,165), img_mat), -18),
+					vec3(130,0,65));
+
+	// Noises on sphere
+	list[i++] = new sphere(vec3(380, 0, 180), 100, pertext);
+	//list[i++] = new rotate_y(new sphere(vec3(280, 40, 150), 40, turbtext), 15);
+
+	// Turbulence floor
+	list[i++] = new xz_rect(0, 555, 0, 555, 0, turbtext);
+	*/
+
+	// Solid small box
+	/*
+	list[i++] = new translate(
+					new rotate_y(new box(vec3(0,0,0), vec3(70,70,70), yellow), 5),
+					vec3(200,165,120));
+	*/
+
+	/*
+	////////////// glass sphere //////////////
+	material *glass = new dielectric(1.5);
+    list[i++] = new sphere(vec3(190, 90, 190),90 , glass);
+    */
+
+
+    ////////////// Metal box tall //////////////
+    /*
+	material *aluminum = new metal(vec3(0.8, 0.85, 0.88), 0.0);
+	list[i++] = new translate(
+					new rotate_y(new box(vec3(0, 0, 0), vec3(165, 330, 165), aluminum),  15),
+					vec3(265,0,295));
+	*/
+
+
+
+	////////// Last image //////////
+	/*
+	int nx, ny, nn;
+	unsigned char *tex_data = stbi_load("../texture_img/thankyou.png", &nx, &ny, &nn, 0);
+	material *img_mat = new lambertian(new image_texture(tex_data, nx, ny), texture_map);
+	list[i++] = new flip_normals(new xy_rect(0, 555, 0, 555, 555, img_mat));
+
+	tex_data = stbi_load("../texture_img/tommy.jpg", &nx, &ny, &nn, 0);
+	img_mat = new lambertian(new image_texture(tex_data, nx, ny), texture_map);
+	list[i++] = new translate(
+					new rotate_y(new box(vec3(0, 0, 0), vec3(165, 330, 165), img_mat),  15),
+					vec3(265,0,295));
+	*/
+
+	return new hittable_list(list,i);
+}
+
+hittable *cornell_smoke() {
+	hittable **list = new hittable*[8];
+	int i = 0;
+	material *red = new lambertian(new constant_texture(vec3(0.65, 0.05, 0.05)));
+	material *white = new lambertian(new constant_texture(vec3(0.73, 0.73, 0.73)));
+	material *green = new lambertian(new constant_texture(vec3(0.12, 0.45, 0.15)));
+	material *light = new diffuse_light(new constant_texture(vec3(7, 7, 7)));
+
+	list[i++] = new flip_normals(new yz_rect(0, 555, 0, 555, 555, green));
+	list[i++] = new yz_rect(0, 555, 0, 555, 0, red);
+	list[i++] = new xz_rect(113, 443, 127, 432, 554, light);
+	list[i++] = new flip_normals(new xz_rect(0, 555, 0, 555, 555, white));
+	list[i++] = new xz_rect(0, 555, 0, 555, 0, white);
+	list[i++] = new flip_normals(new xy_rect(0, 555, 0, 555, 555, white));
+
+	hittable *b1 = new instance(new box(vec3(0, 0, 0), vec3(165, 165, 165), white),
+								translation(vec3(130,0,65)) * rotation_y(-18));
+	hittable *b2 = new instance(new box(vec3(0, 0, 0), vec3(165, 330, 165), white),
+								translation(vec3(265,0,295)) * rotation_y(15));
+
+	list[i++] = new constant_medium(b1, 0.01, new constant_texture(vec3(1.0, 1.0, 1.0)));
+    list[i++] = new constant_medium(b2, 0.01, new constant_texture(vec3(0.0, 0.0, 0.0)));
+
+	return new hittable_list(list,i);
+}
+
+hittable *final() {
+	int nb = 20;
+	hittable **list = new hittable*[30];
+	hittable **boxlist = new hittable*[10000];
+	hittable **boxlist2 = new hittable*[10000];
+	material *white = new lambertian( new constant_texture(vec3(0.73, 0.73, 0.73)));
+	material *ground = new lambertian( new constant_texture(vec3(0.48, 0.83, 0.53)));
+
+	int b = 0;
+	for (int i = 0; i < nb; i++) {
+		for (int j = 0; j < nb; j++) {
+			float w = 100;
+			float x0 = -1000 + i*w;
+			float z0 = -1000 + j*w;
+			float y0 = 0;
+			float x1 = x0 + w;
+			float y1 = 100*(random_float()+0.01);
+			float z1 = z0 + w;
+			boxlist[b++] = new box(vec3(x0,y0,z0), vec3(x1,y1,z1), ground);
+		}
+	}
+	int l = 0;
+	list[l++] = make_bvh(boxlist, b, 0, 1);
+	material *light = new diffuse_light( new constant_texture(vec3(7, 7, 7)));
+	list[l++] = new xz_rect(123, 423, 147, 412, 554, light);
+	vec3 center(400, 400, 200);
+	list[l++] = new moving_sphere(center, center+vec3(30, 0, 0),
+								0, 1, 50, new lambertian(new constant_texture(vec3(0.7, 0.3, 0.1))));
+	list[l++] = new sphere(vec3(260, 150, 45), 50, new dielectric(1.5));
+	list[l++] = new sphere(vec3(0, 150, 145), 50, new metal(vec3(0.8, 0.8, 0.9), 10.0));
+	hittable *boundary = new sphere(vec3(360, 150, 145), 70, new dielectric(1.5));
+	list[l++] = boundary;
+	list[l++] = new constant_medium(boundary, 0.2, new constant_texture(vec3(0.2, 0.4, 0.9)));
+	boundary = new sphere(vec3(0, 0, 0), 5000, new dielectric(1.5));
+	list[l++] = new constant_medium(boundary, 0.0001, new constant_texture(vec3(1.0, 1.0, 1.0)));
+	int nx, ny, nn;
+	unsigned char *tex_data = load_texture("../texture_img/earthmap.jpg", &nx, &ny, &nn);
+	material *emat =  new lambertian(new image_texture(tex_data, nx, ny), texture_map);
+	list[l++] = new sphere(vec3(400, 200, 400), 100, emat);
+	texture *pertext = new noise_texture(0.1);
+	list[l++] =  new sphere(vec3(220, 280, 300), 80, new lambertian( pertext ));
+
+	int ns = 1000;
+	for (int j = 0; j < ns; j++) {
+		boxlist2[j] = new sphere(vec3(165*random_float(), 165*random_float(), 165*random_float()), 10, white);
+	}
+	list[l++] = new instance(make_bvh(boxlist2, ns, 0.0, 1.0), translation(vec3(-100,270,395)) * rotation_y(15));
+
+	return new hittable_list(list,l);
+}
+
+// The --obj mesh standing on the origin with a largest side of 1, placed by instances
+triangle_mesh *load_unit_mesh(material *m) {
+	return load_obj_cached(obj_file, m, vec3(0, 0, 0), 1, use_mesh_cache);
+}
+
+// Empty Cornell box with the --obj mesh standing in the middle
+hittable *cornell_mesh() {
+	hittable **list = new hittable*[7];
+	int i = 0;
+	material *red = new lambertian(new constant_texture(vec3(0.65, 0.05, 0.05)));
+	material *white = new lambertian(new constant_texture(vec3(0.73, 0.73, 0.73)));
+	material *green = new lambertian(new constant_texture(vec3(0.12, 0.45, 0.15)));
+	material *light = new diffuse_light(new constant_texture(vec3(15, 15, 15)));
+
+	list[i++] = new flip_normals(new yz_rect(0, 555, 0, 555, 555, green));
+	list[i++] = new yz_rect(0, 555, 0, 555, 0, red);
+	list[i++] = new flip_normals(new xz_rect(213, 343, 227, 332, 554, light));
+	list[i++] = new flip_normals(new xz_rect(0, 555, 0, 555, 555, white));
+	list[i++] = new xz_rect(0, 555, 0, 555, 0, white);
+	list[i++] = new flip_normals(new xy_rect(0, 555, 0, 555, 555, white));
+
+	if (obj_file) {
+		triangle_mesh *mesh = load_unit_mesh(white);
+		if (mesh) list[i++] = new instance(mesh, translation(vec3(278, 0, 278)) * scaling(330));
+	}
+
+	return new hittable_list(list,i);
+}
+
+// Copies of the --obj mesh per side of the grid in mesh_instances()
+const int mesh_grid = 100;
+
+// Cornell box floor covered with copies of the --obj mesh, turned and scaled at random
+// Every copy is an instance of the same mesh and BVH, the top-level BVH goes over the instances
+hittable *mesh_instances() {
+	hittable **list = new hittable*[6 + mesh_grid*mesh_grid];
+	int i = 0;
+	material *red = new lambertian(new constant_texture(vec3(0.65, 0.05, 0.05)));
+	material *white = new lambertian(new constant_texture(vec3(0.73, 0.73, 0.73)));
+	material *green = new lambertian(new constant_texture(vec3(0.12, 0.45, 0.15)));
+	material *light = new diffuse_light(new constant_texture(vec3(15, 15, 15)));
+
+	list[i++] = new flip_normals(new yz_rect(0, 555, 0, 555, 555, green));
+	list[i++] = new yz_rect(0, 555, 0, 555, 0, red);
+	list[i++] = new flip_normals(new xz_rect(213, 343, 227, 332, 554, light));
+	list[i++] = new flip_normals(new xz_rect(0, 555, 0, 555, 555, white));
+	list[i++] = new xz_rect(0, 555, 0, 555, 0, white);
+	list[i++] = new flip_normals(new xy_rect(0, 555, 0, 555, 555, white));
+
+	triangle_mesh *mesh = obj_file ? load_unit_mesh(white) : 0;
+	if (!mesh) return new hittable_list(list,i);
+
+	float cell = 555.0f / mesh_grid;
+	for (int gx = 0; gx < mesh_grid; gx++) {
+		for (int gz = 0; gz < mesh_grid; gz++) {
+			float size = cell * (0.5f + 0.4f * random_float());
+			list[i++] = new instance(mesh, translation(vec3((gx + 0.5f) * cell, 0, (gz + 0.5f) * cell))
+										   * rotation_y(360 * random_float()) * scaling(size));
+		}
+	}
+	printf("%d instances of %d triangles: mesh and BVH %.1f MB, instances %.1f MB\n", mesh_grid*mesh_grid,
+		   mesh->triangle_count(), (mesh->geometry_bytes() + mesh->bvh_bytes()) / 1048576.0,
+		   mesh_grid*mesh_grid * sizeof(instance) / 1048576.0);
+
+	return new hittable_list(list,i);
+}
+
+/*
+void cornell_box(hittable **scene, camera **cam, float aspect) {
+	int i = 0;
+	hittable **list = new hittable*[8];
+
+	material *red = new lambertian( new constant_texture(vec3(0.65, 0.05, 0.05)) );
+	material *white = new lambertian( new constant_texture(vec3(0.73, 0.73, 0.73)) );
+	material *green = new lambertian( new constant_texture(vec3(0.12, 0.45, 0.15)) );
+	material *light = new diffuse_light( new constant_texture(vec3(15, 15, 15)) );
+
+	list[i++] = new flip_normals(new yz_rect(0, 555, 0, 555, 555, green));
+	list[i++] = new yz_rect(0, 555, 0, 555, 0, red);
+	list[i++] = new xz_rect(213, 343, 227, 332, 554, light);
+	list[i++] = new flip_normals(new xz_rect(0, 555, 0, 555, 555, white));
+	list[i++] = new xz_rect(0, 555, 0, 555, 0, white);
+	list[i++] = new flip_normals(new xy_rect(0, 555, 0, 555, 555, white));
+	list[i++] = new translate(new rotate_y(
+		new box(vec3(0, 0, 0), vec3(165, 165, 165), white), -18), vec3(130,0,65));
+	list[i++] = new translate(new rotate_y(
+		new box(vec3(0, 0, 0), vec3(165, 330, 165), white),  15), vec3(265,0,295));
+
+	*scene = new hittable_list(list, i);
+	vec3 lookfrom(278, 278, -800);
+	vec3 lookat(278, 278, 0);
+	float dist_to_focus = 10.0;
+	float aperture = 0.0;
+	float vfov = 40.0;
+	*cam = new camera(lookfrom, lookat, vec3(0,1,0),
+					vfov, aspect, aperture, dist_to_focus, 0.0, 1.0);
+}
+*/
+
+#endif
@@ -0,0 +1,151 @@
+#ifndef STATSH
+#define STATSH
+
+#include <stdint.h>
+#include <cstdio>
+#include <mutex>
+
+// Ray tracing counters, compiled in with -DPT_STATS (the macros below are empty otherwise)
+// Every thread counts into its own copy; a copy is merged into the totals when its thread exits
+struct ray_stats {
+	ray_stats() { clear(); }
+
+	void clear() {
+		camera_rays = 0;
+		rays = 0;
+		secondary_rays = 0;
+		light_rays = 0;
+		bvh_nodes = 0;
+		aabb_tests = 0;
+		sphere_tests = 0;
+		rect_tests = 0;
+		triangle_tests = 0;
+		box_tests = 0;
+		medium_tests = 0;
+		instance_tests = 0;
+		lambertian_scatters = 0;
+		metal_scatters = 0;
+		dielectric_scatters = 0;
+		rr_kills = 0;
+		nans = 0;
+	}
+
+	ray_stats& operator+=(const ray_stats& o) {
+		camera_rays += o.camera_rays;
+		rays += o.rays;
+		secondary_rays += o.secondary_rays;
+		light_rays += o.light_rays;
+		bvh_nodes += o.bvh_nodes;
+		aabb_tests += o.aabb_tests;
+		sphere_tests += o.sphere_tests;
+		rect_tests += o.rect_tests;
+		triangle_tests += o.triangle_tests;
+		box_tests += o.box_tests;
+		medium_tests += o.medium_tests;
+		instance_tests += o.instance_tests;
+		lambertian_scatters += o.lambertian_scatters;
+		metal_scatters += o.metal_scatters;
+		dielectric_scatters += o.dielectric_scatters;
+		rr_kills += o.rr_kills;
+		nans += o.nans;
+		return *this;
+	}
+
+	uint64_t camera_rays;         // paths started
+	uint64_t rays;                // rays traced against the world, camera rays included
+	uint64_t secondary_rays;      // bounce rays (rays - camera_rays)
+	uint64_t light_rays;          // rays tested against the light shape for light sampling
+	uint64_t bvh_nodes;           // BVH nodes visited (any layout)
+	uint64_t aabb_tests;          // ray-box slab tests, a wide node counts one per child slot
+	uint64_t sphere_tests;        // sphere and moving_sphere hit() calls
+	uint64_t rect_tests;          // xy/xz/yz_rect hit() calls
+	uint64_t triangle_tests;      // ray-triangle tests inside meshes
+	uint64_t box_tests;           // box hit() calls
+	uint64_t medium_tests;        // constant_medium hit() calls
+	uint64_t instance_tests;      // instance hit() calls that reach the transform
+	uint64_t lambertian_scatters; // scatter() calls per material
+	uint64_t metal_scatters;
+	uint64_t dielectric_scatters;
+	uint64_t rr_kills;            // paths ended by Russian roulette
+	uint64_t nans;                // samples with a NaN removed by de_nan
+};
+
+// Counters of the threads that have exited
+inline ray_stats& retired_stats() {
+	static ray_stats totals;
+	return totals;
+}
+
+inline std::mutex& stats_mutex() {
+	static std::mutex m;
+	return m;
+}
+
+struct thread_stats_slot {
+	~thread_stats_slot() {
+		std::lock_guard<std::mutex> lock(stats_mutex());
+		retired_stats() += stats;
+	}
+
+	ray_stats stats;
+};
+
+inline ray_stats& thread_stats() {
+	static thread_local thread_stats_slot slot;
+	return slot.stats;
+}
+
+// Totals of all threads; call it after the workers have been joined
+inline ray_stats collect_stats() {
+	std::lock_guard<std::mutex> lock(stats_mutex());
+	ray_stats totals = retired_stats();
+	totals += thread_stats();
+	return totals;
+}
+
+inline void reset_stats() {
+	std::lock_guard<std::mutex> lock(stats_mutex());
+	retired_stats().clear();
+	thread_stats().clear();
+}
+
+inline double stats_average(uint64_t n, uint64_t d) { return d > 0 ? double(n) / double(d) : 0; }
+
+// Summary table: totals, and averages per camera ray (path) and per traced ray
+inline void print_stats(const ray_stats& s) {
+	struct row { const char *name; uint64_t value; };
+	const row rows[] = {
+		{ "camera rays", s.camera_rays },
+		{ "secondary rays", s.secondary_rays },
+		{ "light sample rays", s.light_rays },
+		{ "BVH nodes visited", s.bvh_nodes },
+		{ "AABB tests", s.aabb_tests },
+		{ "sphere tests", s.sphere_tests },
+		{ "rect tests", s.rect_tests },
+		{ "triangle tests", s.triangle_tests },
+		{ "box tests", s.box_tests },
+		{ "medium tests", s.medium_tests },
+		{ "instance tests", s.instance_tests },
+		{ "lambertian scatters", s.lambertian_scatters },
+		{ "metal scatters", s.metal_scatters },
+		{ "dielectric scatters", s.dielectric_scatters },
+		{ "Russian roulette kills", s.rr_kills },
+		{ "NaN samples removed", s.nans }
+	};
+
+	printf("%-24s %16s %14s %12s\n", "counter", "total", "per path", "per ray");
+	for (size_t k = 0; k < sizeof(rows) / sizeof(rows[0]); k++)
+		printf("%-24s %16llu %14.3f %12.3f\n", rows[k].name, (unsigned long long)rows[k].value,
+			   stats_average(rows[k].value, s.camera_rays), stats_average(rows[k].value, s.rays));
+	printf("%-24s %16llu %14.3f\n", "rays traced", (unsigned long long)s.rays, stats_average(s.rays, s.camera_rays));
+}
+
+#ifdef PT_STATS
+#define PT_STAT(field) (thread_stats().field++)
+#define PT_STAT_ADD(field, n) (thread_stats().field += (n))
+#else
+#define PT_STAT(field) ((void)0)
+#define PT_STAT_ADD(field, n) ((void)(n))
+#endif
+
+#endif
@@ -1,6 +1,8 @@
 #ifndef PERLINH
 #define PERLINH
 
+#include "../sampler.h"
+
 inline float trilinear_interp(float c[2][2][2], float u, float v, float w);
 inline float perlin_interp(vec3 c[2][2][2], float u, float v, float w);
 
@@ -81,13 +83,17 @@ inline float perlin_interp(vec3 c[2][2][2], float u, float v, float w) {
 	return accum;
 }
 
+// Lattice tables are filled from their own fixed stream during static initialization,
+// so they are identical on every run and do not shift the numbers seen by the renderer
+static pcg32 perlin_rng(0x5eed, 0x9e71);
+
 static vec3* perlin_generate() {
 	vec3 *p = new vec3[256];
 	for (int i = 0; i < 256; ++i) {
 		// Make a random unit vector on the lattice points
-		double x_random = 2*random_double() - 1;
-		double y_random = 2*random_double() - 1;
-		double z_random = 2*random_double() - 1;
+		double x_random = 2*perlin_rng.next_float() - 1;
+		double y_random = 2*perlin_rng.next_float() - 1;
+		double z_random = 2*perlin_rng.next_float() - 1;
 		p[i] = unit_vector(vec3(x_random, y_random, z_random));
 	}
 	return p;
@@ -95,7 +101,7 @@ static vec3* perlin_generate() {
 
 void permute(int *p, int n) {
 	for (int i = n-1; i > 0; i--) {
-		int target = int(random_double()*(i+1));
+		int target = int(perlin_rng.next_float()*(i+1));
 		int tmp = p[i];
 		p[i] = p[target];
 		p[target] = tmp;
@@ -0,0 +1,165 @@
+#ifndef TRACEH
+#define TRACEH
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// Timeline of scoped events (--trace), written as Chrome trace JSON at exit
+// Open the file in chrome://tracing or ui.perfetto.dev: one row per track, a track per tile worker
+// Every track is written by one thread at a time (the workers of a pass are joined before the next pass),
+// so recording takes no lock; the buffers are only read by the dump, after the workers are gone
+struct trace_event {
+	const char *name;     // string literals only, they are read by the dump
+	const char *category;
+	const char *detail;   // optional string argument, must outlive the dump (literals, argv)
+	long long index;      // optional integer argument, -1 = none
+	uint64_t start_ns, end_ns;
+};
+
+struct trace_track {
+	trace_track() { events.reserve(4096); }
+
+	std::string name;
+	std::vector<trace_event> events;
+};
+
+const int trace_max_tracks = 256;
+
+struct trace_recorder {
+	trace_recorder() : enabled(false), n_tracks(0) {}
+
+	bool enabled;
+	std::string path;
+	std::chrono::steady_clock::time_point origin;
+	trace_track *tracks[trace_max_tracks];
+	std::atomic<int> n_tracks;
+};
+
+inline trace_recorder& tracer() {
+	static trace_recorder recorder;
+	return recorder;
+}
+
+inline uint64_t trace_now() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - tracer().origin).count();
+}
+
+// Track of the calling thread; -1 until it records or is bound
+inline int& thread_trace_track() {
+	static thread_local int track = -1;
+	return track;
+}
+
+// A new track, or -1 when all are taken
+inline int trace_new_track(const std::string& name) {
+	trace_recorder& t = tracer();
+	int k = t.n_tracks.fetch_add(1);
+	if (k >= trace_max_tracks) return -1;
+	t.tracks[k] = new trace_track();
+	t.tracks[k]->name = name;
+	return k;
+}
+
+// Tile workers record on the track of their worker id, whichever thread runs it in this pass
+inline void trace_bind_worker(int worker) {
+	if (tracer().enabled) thread_trace_track() = worker;
+}
+
+void trace_dump();
+
+// Starts recording; tracks 0..n_workers-1 belong to the tile workers (the calling thread is worker 0)
+void trace_start(const char *path, int n_workers) {
+	trace_recorder& t = tracer();
+	t.path = path;
+	t.origin = std::chrono::steady_clock::now();
+	for (int k = 0; k < n_workers; k++) {
+		char name[32];
+		snprintf(name, sizeof(name), k == 0 ? "main / worker %d" : "worker %d", k);
+		trace_new_track(name);
+	}
+	thread_trace_track() = 0;
+	t.enabled = true;
+	atexit(trace_dump);
+}
+
+// Records the enclosing block as one event
+struct trace_scope {
+	trace_scope(const char *name, const char *category, const char *detail = 0, long long index = -1) : track(0) {
+		if (!tracer().enabled) return;
+		int& k = thread_trace_track();
+		if (k < 0) k = trace_new_track("thread");
+		if (k < 0) return;
+		track = tracer().tracks[k];
+		e.name = name;
+		e.category = category;
+		e.detail = detail;
+		e.index = index;
+		e.start_ns = trace_now();
+	}
+
+	~trace_scope() {
+		if (!track) return;
+		e.end_ns = trace_now();
+		track->events.push_back(e);
+	}
+
+	trace_track *track;
+	trace_event e;
+};
+
+// JSON string of a name or path (quotes, backslashes and control characters escaped)
+inline std::string trace_json_string(const char *s) {
+	std::string out = "\"";
+	for (; *s; s++) {
+		if (*s == '"' || *s == '\\') out += '\\';
+		if ((unsigned char)*s < 0x20) out += ' ';
+		else out += *s;
+	}
+	return out + "\"";
+}
+
+// Complete ("X") events in microseconds, and a thread_name record per track
+void trace_dump() {
+	trace_recorder& t = tracer();
+	if (!t.enabled) return;
+	t.enabled = false;
+
+	FILE *f = fopen(t.path.c_str(), "w");
+	if (!f) {
+		fprintf(stderr, "Failed to write trace %s\n", t.path.c_str());
+		return;
+	}
+
+	int n = t.n_tracks.load();
+	if (n > trace_max_tracks) n = trace_max_tracks;
+	size_t count = 0;
+	fprintf(f, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+	for (int k = 0; k < n; k++) {
+		const trace_track& track = *t.tracks[k];
+		fprintf(f, "%s{\"ph\": \"M\", \"name\": \"thread_name\", \"pid\": 1, \"tid\": %d, \"args\": {\"name\": %s}}",
+				k == 0 ? "" : ",\n", k, trace_json_string(track.name.c_str()).c_str());
+		for (size_t i = 0; i < track.events.size(); i++) {
+			const trace_event& e = track.events[i];
+			fprintf(f, ",\n{\"ph\": \"X\", \"name\": %s, \"cat\": \"%s\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f",
+					trace_json_string(e.name).c_str(), e.category, k, e.start_ns * 1e-3, (e.end_ns - e.start_ns) * 1e-3);
+			if (e.detail || e.index >= 0) {
+				fprintf(f, ", \"args\": {");
+				if (e.detail) fprintf(f, "\"detail\": %s", trace_json_string(e.detail).c_str());
+				if (e.index >= 0) fprintf(f, "%s\"index\": %lld", e.detail ? ", " : "", e.index);
+				fprintf(f, "}");
+			}
+			fprintf(f, "}");
+		}
+		count += track.events.size();
+	}
+	fprintf(f, "\n]}\n");
+	fclose(f);
+	printf("Trace of %zu events written to %s\n", count, t.path.c_str());
+}
+
+#endif
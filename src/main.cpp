@@ -1,52 +1,47 @@
 /* C++ standard libraries */
 #include <iostream> // cout
 #include <fstream>  // file i/o
+#include <cstring>  // strcmp
+#include <algorithm> // min
+#include <chrono>
 
 /* Other headers */
 // Include a header once once within a project!
 #include "float.h"
 
-#include "../include/hittable/hittable_list.h"
-#include "../include/hittable/sphere.h"
-#include "../include/hittable/moving_sphere.h"
-#include "../include/hittable/xy_rect.h"
-#include "../include/hittable/yz_rect.h"
-#include "../include/hittable/xz_rect.h"
-#include "../include/hittable/flip_normals.h"
-#include "../include/hittable/box.h"
-#include "../include/hittable/translate.h"
-#include "../include/hittable/rotate_y.h"
-#include "../include/hittable/constant_medium.h"
-#include "../include/hittable/bvh_node.h"
-
-#include "../include/material/diffuse_light.h"
-#include "../include/material/dielectric.h"
-#include "../include/material/isotropic.h"
-#include "../include/material/lambertian.h"
-#include "../include/material/metal.h"
-
+#include "../include/scene/scene_registry.h"
+#include "../include/scene/scene_optimizer.h"
 #include "../include/camera.h"
 #include "../include/random.h"
 
-#include "../include/texture/constant_texture.h"
-#include "../include/texture/checker_texture.h"
-#include "../include/texture/noise_texture.h"
-#include "../include/texture/image_texture.h"
-
 //#include "../include/pdf/cosine_pdf.h"
 #include "../include/pdf/hittable_pdf.h"
 #include "../include/pdf/mixture_pdf.h"
 
 #include "../include/hammersley.h"
 
+#include "../include/render/framebuffer.h"
+#include "../include/render/tile_scheduler.h"
+#include "../include/render/integrator.h"
+#include "../include/render/adaptive.h"
+#include "../include/render/tonemap.h"
+#include "../include/render/accumulation.h"
+#include "../include/render/framebuffer_file.h"
+#include "../include/render/heatmap.h"
+#include "../include/perf_counters.h"
+#include "../include/trace.h"
+
 #define STB_IMAGE_IMPLEMENTATION
 #include "../libs/stb/stb_image.h"
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "../libs/stb/stb_image_write.h"
 
 
 using namespace std;
 
 inline vec3 de_nan(const vec3& c) {
 	vec3 temp = c;
+	if (!(temp[0] == temp[0] && temp[1] == temp[1] && temp[2] == temp[2])) PT_STAT(nans);
 	if (!(temp[0] == temp[0])) temp[0] = 0;
 	if (!(temp[1] == temp[1])) temp[1] = 0;
 	if (!(temp[2] == temp[2])) temp[2] = 0;
@@ -54,604 +49,481 @@ inline vec3 de_nan(const vec3& c) {
 }
 
 
-/* Global variables */
-bool texture_map;
-bool use_ambient;
-enum scene {
-	random_s,
-	moving_spheres_zoomin_s,
-	two_spheres_s,
-	two_perlin_spheres_s,
-	image_texture_s,
-	simple_light_s,
-	cornell_box_s,
-	cornell_smoke_s,
-	final_s
-};
-
-
 /* Function prototypes */
-hittable *get_world(scene s);
-camera set_camera(scene s, int nx, int ny);
-vec3 color(const ray& r, hittable *world, hittable *light_shape, int depth);
-
-hittable *random_scene();
-hittable *moving_spheres_zoomin();
-hittable *two_spheres();
-hittable *two_perlin_spheres();
-hittable *image_textured_spheres();
-hittable *simple_light();
-hittable *cornell_box();
-hittable *cornell_smoke();
-hittable *final();
-
-//void cornell_box(hittable **scene, camera **cam, float aspect);
+void report_bvh_cost(uint64_t seed);
+bool ends_with(const string& s, const char *suffix);
 
 
 /*
  * main
  *
  * Under src directory...
- * Compile: g++ -std=c++11 main.cpp vec3.cpp -o main
- * Run:	    ./main
+ * Compile: g++ -std=c++11 -O2 -pthread main.cpp -o main
+ *          (add -DPT_STATS to print ray tracing counters at the end)
+ * Run:	    ./main [--scene name] [--width N] [--height N] [--spp N] [--seed N] [--threads N] [--output file.ppm]
  *
 */
 int main(int argc, char * argv[]) {
-	cout << "Rendering begins..." << endl;
-
-	//if ( argc == 1 ) {
-	//	cout << "Expected: ./main obj_file_name" << endl;
-	//	return 0;
-	//}
-
-	// Choose from { random_s, moving_spheres_zoomin_s, two_spheres_s, two_perlin_spheres_s, image_texture_s, simple_light_s, cornell_box_s, cornell_smoke_s, final_s }
-	scene s = cornell_box_s;
-
-	if (s == image_texture_s || s == final_s) texture_map = true;
-	else texture_map = false;
-
-	if (s == simple_light_s || s == cornell_box_s || s == cornell_smoke_s || s == final_s) use_ambient = false;
-	else use_ambient = true;
-
-	int nx, ny;
-	if (s == cornell_smoke_s || s == final_s) {
-		nx = 300;
-		ny = 300;
-	} else if (s == cornell_box_s) {
-		nx = 500;
-		ny = 500;
-	} else {
-		nx = 500; //200;
-		ny = 300; //100;
+	// Options: --scene name, --list-scenes, --width N, --height N, --spp N, --seed N, --output file.ppm,
+	//          --threads N, --bvh binary|bvh4|bvh8, --brute-force, --no-optimize, --bvh-report, --max-depth N, --rr-depth N,
+	//          --adaptive, --min-spp N, --max-spp N, --max-error E, --spp-image file,
+	//          --hdr file, --scale S, --gamma G, --tonemap in.pfm|in.hdr out.ppm,
+	//          --pass-spp N, --checkpoint file, --checkpoint-interval S, --mmap file, --resume,
+	//          --heatmap prefix (builds with -DPT_STATS), --perf, --trace file.json, --obj file.obj, --no-mesh-cache
+	const char *scene_name = 0; // cornell_box, or cornell_mesh with --obj
+	int nx = 0, ny = 0; // 0 = the scene's default
+	int ns = 1000;
+	uint64_t seed = 0; // same seed, same image (for any thread count)
+	string output = "../rendered_img/output.ppm";
+	bool list_scenes = false;
+	int n_threads = default_thread_count();
+	int max_depth = 50;
+	int rr_depth = 3; // > max_depth turns Russian roulette off
+	adaptive_settings adaptive;
+	const char *spp_image = 0;
+	const char *hdr_output = 0;
+	const char *tonemap_input = 0;
+	const char *tonemap_output = 0;
+	tonemap_settings ts;
+	int pass_spp = 0; // 0 = everything in one pass
+	const char *checkpoint = 0;
+	float checkpoint_interval = 60; // seconds
+	const char *mmap_file = 0;
+	bool resume = false;
+	const char *heatmap = 0;
+	bool perf_counters = false;
+	const char *trace_file = 0;
+	bool brute_force = false;
+	bool optimize = true;
+	bool bvh_report = false;
+	bool bad_option = false;
+	for (int k = 1; k < argc; k++) {
+		if (strcmp(argv[k], "--scene") == 0 && k+1 < argc) scene_name = argv[++k];
+		else if (strcmp(argv[k], "--list-scenes") == 0) list_scenes = true;
+		else if (strcmp(argv[k], "--width") == 0 && k+1 < argc) nx = atoi(argv[++k]);
+		else if (strcmp(argv[k], "--height") == 0 && k+1 < argc) ny = atoi(argv[++k]);
+		else if (strcmp(argv[k], "--spp") == 0 && k+1 < argc) ns = atoi(argv[++k]);
+		else if (strcmp(argv[k], "--seed") == 0 && k+1 < argc) seed = strtoull(argv[++k], 0, 10);
+		else if ((strcmp(argv[k], "--output") == 0 || strcmp(argv[k], "-o") == 0) && k+1 < argc) output = argv[++k];
+		else if (strcmp(argv[k], "--threads") == 0 && k+1 < argc) n_threads = atoi(argv[++k]);
+		else if (strcmp(argv[k], "--bvh") == 0 && k+1 < argc) {
+			k++;
+			if (strcmp(argv[k], "binary") == 0) default_bvh_layout = bvh_binary;
+			else if (strcmp(argv[k], "bvh4") == 0) default_bvh_layout = bvh_wide4;
+			else if (strcmp(argv[k], "bvh8") == 0) default_bvh_layout = bvh_wide8;
+			else bad_option = true;
+		}
+		else if (strcmp(argv[k], "--brute-force") == 0) brute_force = true;
+		else if (strcmp(argv[k], "--no-optimize") == 0) optimize = false;
+		else if (strcmp(argv[k], "--bvh-report") == 0) bvh_report = true;
+		else if (strcmp(argv[k], "--max-depth") == 0 && k+1 < argc) max_depth = atoi(argv[++k]);
+		else if (strcmp(argv[k], "--rr-depth") == 0 && k+1 < argc) rr_depth = atoi(argv[++k]);
+		else if (strcmp(argv[k], "--adaptive") == 0) adaptive.enabled = true;
+		else if (strcmp(argv[k], "--min-spp") == 0 && k+1 < argc) adaptive.min_spp = atoi(argv[++k]);
+		else if (strcmp(argv[k], "--max-spp") == 0 && k+1 < argc) adaptive.max_spp = atoi(argv[++k]);
+		else if (strcmp(argv[k], "--max-error") == 0 && k+1 < argc) adaptive.max_error = atof(argv[++k]);
+		else if (strcmp(argv[k], "--spp-image") == 0 && k+1 < argc) spp_image = argv[++k];
+		else if (strcmp(argv[k], "--hdr") == 0 && k+1 < argc) hdr_output = argv[++k];
+		else if (strcmp(argv[k], "--scale") == 0 && k+1 < argc) ts.scale = atof(argv[++k]);
+		else if (strcmp(argv[k], "--gamma") == 0 && k+1 < argc) ts.gamma = atof(argv[++k]);
+		else if (strcmp(argv[k], "--tonemap") == 0 && k+2 < argc) {
+			tonemap_input = argv[++k];
+			tonemap_output = argv[++k];
+		}
+		else if (strcmp(argv[k], "--pass-spp") == 0 && k+1 < argc) pass_spp = atoi(argv[++k]);
+		else if (strcmp(argv[k], "--checkpoint") == 0 && k+1 < argc) checkpoint = argv[++k];
+		else if (strcmp(argv[k], "--checkpoint-interval") == 0 && k+1 < argc) checkpoint_interval = atof(argv[++k]);
+		else if (strcmp(argv[k], "--mmap") == 0 && k+1 < argc) mmap_file = argv[++k];
+		else if (strcmp(argv[k], "--resume") == 0) resume = true;
+		else if (strcmp(argv[k], "--heatmap") == 0 && k+1 < argc) heatmap = argv[++k];
+		else if (strcmp(argv[k], "--perf") == 0) perf_counters = true;
+		else if (strcmp(argv[k], "--obj") == 0 && k+1 < argc) obj_file = argv[++k];
+		else if (strcmp(argv[k], "--no-mesh-cache") == 0) use_mesh_cache = false;
+		else if (strcmp(argv[k], "--trace") == 0 && k+1 < argc) trace_file = argv[++k];
+		else bad_option = true;
+	}
+	if (resume && !checkpoint && !mmap_file) bad_option = true;
+	if (nx < 0 || ny < 0 || ns <= 0) bad_option = true;
+	if (bad_option) {
+		cerr << "Usage: ./main [--scene name] [--list-scenes] [--width N] [--height N] [--spp N] [--seed N] [--output file.ppm]"
+			 << " [--threads N] [--bvh binary|bvh4|bvh8] [--brute-force] [--no-optimize] [--bvh-report]"
+			 << " [--max-depth N] [--rr-depth N]"
+			 << " [--adaptive [--min-spp N] [--max-spp N] [--max-error E]] [--spp-image file]"
+			 << " [--hdr file] [--scale S] [--gamma G]"
+			 << " [--pass-spp N] [--checkpoint file [--checkpoint-interval S]] [--mmap file] [--resume]"
+			 << " [--heatmap prefix] [--perf] [--trace file.json] [--obj file.obj [--no-mesh-cache]]" << endl;
+		cerr << "       ./main --tonemap in.pfm|in.hdr out.ppm [--scale S] [--gamma G]" << endl;
+		return 1;
 	}
 
-	int ns = 1000;
+#ifndef PT_STATS
+	// The heatmap reads the ray tracing counters, which only exist in a -DPT_STATS build
+	if (heatmap) {
+		cerr << "--heatmap needs a build with -DPT_STATS" << endl;
+		return 1;
+	}
+#endif
+
+	// Tonemap a saved frame again without rendering
+	if (tonemap_input) {
+		framebuffer saved;
+		if (!saved.read(tonemap_input)) {
+			cerr << "Failed to read " << tonemap_input << endl;
+			return 1;
+		}
+		if (!write_ppm(tonemap_output, tonemap(saved, ts), saved.nx, saved.ny)) {
+			cerr << "Failed to write " << tonemap_output << endl;
+			return 1;
+		}
+		cout << "Tonemapped " << tonemap_input << " to " << tonemap_output << endl;
+		return 0;
+	}
 
-	ofstream outfile;
-	outfile.open ("../rendered_img/output.ppm");
-	outfile << "P3\n" << nx << " " << ny << "\n255\n";
+	if (list_scenes) {
+		for (int k = 0; k < scene_count; k++)
+			cout << scene_registry[k].name << " (" << scene_registry[k].width << "x" << scene_registry[k].height << ")" << endl;
+		return 0;
+	}
+
+	if (bvh_report) {
+		report_bvh_cost(seed);
+		return 0;
+	}
+
+	if (!scene_name) scene_name = obj_file ? "cornell_mesh" : "cornell_box";
+	int scene_index = find_scene(scene_name);
+	if (scene_index < 0) {
+		cerr << "Unknown scene " << scene_name << " (see --list-scenes)" << endl;
+		return 1;
+	}
+	const scene_desc& scene = scene_registry[scene_index];
+	if ((strcmp(scene.name, "cornell_mesh") == 0 || strcmp(scene.name, "mesh_instances") == 0) && !obj_file) {
+		cerr << "--scene " << scene.name << " needs --obj file.obj" << endl;
+		return 1;
+	}
+
+	// A missing dimension keeps the scene's aspect ratio
+	if (nx == 0 && ny == 0) {
+		nx = scene.width;
+		ny = scene.height;
+	}
+	else if (nx == 0) nx = std::max(1, ny * scene.width / scene.height);
+	else if (ny == 0) ny = std::max(1, nx * scene.height / scene.width);
+
+	// The linear image goes next to the tonemapped one
+	string output_pfm = (ends_with(output, ".ppm") ? output.substr(0, output.size() - 4) : output) + ".pfm";
+
+	// Adaptive pixels take between min_spp and max_spp samples
+	if (adaptive.enabled && adaptive.max_spp > 0) ns = adaptive.max_spp;
+	int min_spp = adaptive.enabled ? std::min(adaptive.min_spp, ns) : ns;
+
+	// Progressive rendering: each pass adds pass_spp samples to every pixel
+	if (pass_spp <= 0 || pass_spp > ns) pass_spp = ns;
+	int n_passes = (ns + pass_spp - 1) / pass_spp;
+	if (adaptive.enabled && n_passes > 1) {
+		cerr << "--adaptive renders in a single pass, --pass-spp is not supported with it" << endl;
+		return 1;
+	}
+
+	cout << "Rendering " << scene.name << " at " << nx << "x" << ny << ", " << ns << " spp..." << endl;
 
 	vec3 lower_left_corner(-2.0, -1.0, -1.0);
 	vec3 horizontal(4.0, 0.0, 0.0); // step interval
 	vec3 vertical(0.0, 2.0, 0.0);   // step interval
 	vec3 origin(0.0, 0.0, 0.0);
 
-	hittable *world = get_world(s);
-	camera cam = set_camera(s, nx, ny);
+	// Hardware counters from here on, for the main thread and the workers it starts
+	if (perf_counters) perf_start(std::max(n_threads, 1));
+	// Timeline of the run, written when main returns
+	if (trace_file) trace_start(trace_file, std::max(n_threads, 1));
 
-	hittable *light_shape = new xz_rect(213, 343, 227, 332, 554, 0);
+	// Scene builders draw from the main thread's sequential stream
+	thread_sampler().seed(seed);
+	hittable *world;
+	{
+		perf_scope scope("scene build");
+		world = build_scene(scene);
+	}
+	camera cam = scene.make_camera(nx, ny);
+
+	// Wrapper chains flattened, then one BVH over the whole scene, unless the plain lists are wanted for validation
+	if (optimize) {
+		perf_scope scope("optimize");
+		world = optimize_scene(world);
+	}
+	if (!brute_force) {
+		perf_scope scope("bvh build");
+		int n_accelerated, n_separate;
+		world = build_accelerator(world, 0.0, 1.0, n_accelerated, n_separate);
+		cout << "Top-level BVH over " << n_accelerated << " objects, "
+			 << n_separate << " unbounded or large objects tested separately" << endl;
+	}
+
+	hittable *light_shape = scene.make_light();
 	hittable *glass_sphere = new sphere(vec3(190, 90, 190), 90, 0);
 	hittable *a[2];
 	a[0] = light_shape;
 	a[1] = glass_sphere;
 	hittable_list hlist(a,2);
 
+	path_integrator integrator(world, light_shape, max_depth, rr_depth, scene.use_ambient);
+	//path_integrator integrator(world, &hlist, max_depth, rr_depth, scene.use_ambient);
+
 	hammersley * hm = new hammersley();
 	double *hammersley_point;
 
-	// Send a ray out of eye (0, 0, 0) from BL to UR corner
-	for (int j = ny-1; j >= 0; j--) {
-		for (int i = 0; i < nx; i++) {
-			// Super sampling
-			vec3 col(0, 0, 0);
-			for (int s = 0; s < ns; s++) {
-				//hammersley_point = hm->get_hammersley(s+1, 2, ns);
-				//float u = float(i + hammersley_point[0]) / float(nx);
-				//float v = float(j + hammersley_point[1]) / float(ny);
-				
-				// Offset by random_double value [0, 1)
-				float u = float(i + random_double()) / float(nx);
-				float v = float(j + random_double()) / float(ny);
-				ray r = cam.get_ray(u, v);
-				vec3 p = r.point_at_parameter(2.0);
-				
-				col += de_nan(color(r, world, light_shape, 0));
-				//col += de_nan(color(r, world, &hlist, 0));
-			}
-			col /= float(ns); // average sum
-			// gamma correction (brighter color)
-			//col = vec3( sqrt(col[0]), sqrt(col[1]), sqrt(col[2]) );
-			col = vec3( 1.5 * sqrt(col[0]), 1.5 * sqrt(col[1]), 1.5 * sqrt(col[2]) );
-
-			// Clamp color to [0, 1]
-			for (int channel = 0; channel < 3; channel++)
-				if (col[channel] > 1.0) col[channel] = 1.0;
-
-			int ir = int(255.99 * col[0]);
-			int ig = int(255.99 * col[1]);
-			int ib = int(255.99 * col[2]);
-
-			outfile << ir << " " << ig << " " << ib << "\n";
-		}
+	accumulation_buffer accum(nx, ny);
+	int tile_size = 16;
+	tile_scheduler scheduler(nx, ny, tile_size, n_threads);
+	cout << "Using " << scheduler.thread_count() << " threads" << endl;
+
+	// A checkpoint only resumes a render with exactly the same settings
+	checkpoint_header header = make_checkpoint_header();
+	header.nx = nx;
+	header.ny = ny;
+	header.seed = seed;
+	header.scene = scene_index;
+	header.spp = ns;
+	header.pass_spp = pass_spp;
+	header.max_depth = max_depth;
+	header.rr_depth = rr_depth;
+	header.accelerator = brute_force ? -1 : default_bvh_layout;
+	if (adaptive.enabled) {
+		header.adaptive = 1;
+		header.min_spp = min_spp;
+		header.max_error = adaptive.max_error;
+	}
+	// The mesh scenes depend on the content of the OBJ file, not just its name
+	uint64_t obj_size;
+	if ((checkpoint || mmap_file) && obj_file && !hash_file(obj_file, header.obj_hash, obj_size)) {
+		cerr << "Failed to read " << obj_file << endl;
+		return 1;
 	}
 
-	outfile.close();
-
-	cout << "Path Tracer Completed!" << endl;
-	return 0;
-}
-
-vec3 color(const ray& r, hittable *world, hittable *light_shape, int depth) {
-	hit_record hrec;
-
-	if (world->hit(r, 0.001, MAXFLOAT, hrec)) {
-		scatter_record srec;
-		vec3 emitted = hrec.mat_ptr->emitted(r, hrec, hrec.u, hrec.v, hrec.p);
-		
-		if (depth < 50 && hrec.mat_ptr->scatter(r, hrec, srec)) {
-			if (srec.is_specular) {
-				// On specular surface, color is only collected from the reflected direction
-				return srec.attenuation * color(srec.specular_ray, world, light_shape, depth+1);
-			} else {
-				hittable_pdf plight(light_shape, hrec.p);
-				mixture_pdf p(&plight, srec.pdf_ptr);
-				ray scattered = ray(hrec.p, p.generate(), r.time());
-				float pdf_val = p.value(scattered.direction());
-				return emitted
-					+ srec.attenuation * hrec.mat_ptr->scattering_pdf(r, hrec, scattered)
-										* color(scattered, world, light_shape, depth+1)
-										/ pdf_val;
-			}
+	// With --mmap, workers accumulate straight into a shared file that viewers can poll
+	// A file left by an interrupted render carries the exact sums of every pixel, so --resume continues it
+	framebuffer_file mapped;
+	bool mapped_resumed = false;
+	if (mmap_file) {
+		if (resume && adaptive.enabled) {
+			cerr << "--resume with --mmap does not support --adaptive" << endl;
+			return 1;
+		}
+		framebuffer_file_header fh = make_framebuffer_file_header(nx, ny, n_passes, tile_size, int(scheduler.tiles.size()), header);
+		bool existed = resume && access(mmap_file, F_OK) == 0;
+		if (!mapped.open(mmap_file, fh, resume, mapped_resumed)) {
+			if (existed) cerr << mmap_file << " is broken or was written with other settings, not resumed" << endl;
+			else cerr << "Failed to map " << mmap_file << endl;
+			return 1;
 		}
-		else return emitted;	
-	} else {
-		if (use_ambient) {
-			// Sky color is a linear interpolation b/w while & blue
-			vec3 unit_direction = unit_vector(r.direction());
-
-			// t is a mapped y from [-1, 1] to [0, 1]
-			// more accurately, t = 0.5 * (sqrt(2)*unit_direction.y() + 1.0)
-			float t = 0.5 * (unit_direction.y() + 1.0);
-
-			return (1.0-t)*vec3(1.0, 1.0, 1.0) + t*vec3(0.5, 0.7, 1.0);
-		} else return vec3(0,0,0);
+		accum.attach(mapped.pixels);
 	}
-}
 
-hittable *get_world(scene s) {
-	switch(s)
-	{
-		case random_s:
-			return random_scene();
-		case moving_spheres_zoomin_s:
-			return moving_spheres_zoomin();
-		case two_spheres_s:
-			return two_spheres();
-		case two_perlin_spheres_s:
-			return two_perlin_spheres();
-		case image_texture_s:
-			return image_textured_spheres();
-		case simple_light_s:
-			return simple_light();
-		case cornell_box_s:
-			return cornell_box();
-		case cornell_smoke_s:
-			return cornell_smoke();
-		case final_s:
-			return final();
-		default:
-			return two_spheres();
+	int first_pass = 0;
+	if (mapped_resumed) {
+		first_pass = mapped.header->pass_count;
+		cout << "Resuming " << mmap_file << " after pass " << first_pass << "/" << n_passes << endl;
 	}
-}
-
-camera set_camera(scene s, int nx, int ny) {
-	vec3 lookfrom, lookat;
-	float dist_to_focus, aperture, vfov;
-
-	switch(s)
-	{
-		case random_s:
-		case two_spheres_s:
-		case two_perlin_spheres_s:
-		case image_texture_s:
-		case simple_light_s:
-			lookfrom = vec3(13,2,3);
-			lookat = vec3(0,0,0);
-			dist_to_focus = 10.0;
-			aperture = 0.0;
-			vfov = 20.0;
-			return camera(lookfrom, lookat, vec3(0,1,0), vfov, float(nx)/float(ny), aperture, dist_to_focus, 0.0, 1.0);
-		case moving_spheres_zoomin_s:
-			lookfrom = vec3(3,3,2);
-			lookat = vec3(0,0,-1);
-			dist_to_focus = (lookfrom-lookat).length();
-			aperture = 0.0;
-			vfov = 20.0;
-			return camera(lookfrom, lookat, vec3(0,1,0), vfov, float(nx)/float(ny), aperture, dist_to_focus, 0.0, 1.0);
-		case cornell_box_s:
-		case cornell_smoke_s:
-		case final_s:
-			lookfrom = vec3(278, 278, -800);
-			lookat = vec3(278,278,0);
-			dist_to_focus = 10.0;
-			aperture = 0.0;
-			vfov = 40.0;
-			return camera(lookfrom, lookat, vec3(0,1,0), vfov, float(nx)/float(ny), aperture, dist_to_focus, 0.0, 1.0);
-		default:
-			lookfrom = vec3(13,2,3);
-			lookat = vec3(0,0,0);
-			dist_to_focus = 10.0;
-			aperture = 0.0;
-			vfov = 20.0;
-			return camera(lookfrom, lookat, vec3(0,1,0), vfov, float(nx)/float(ny), aperture, dist_to_focus, 0.0, 1.0);
+	else if (resume && checkpoint) {
+		if (access(checkpoint, F_OK) != 0)
+			cout << "No checkpoint at " << checkpoint << ", starting from the first pass" << endl;
+		else if (accum.load_checkpoint(checkpoint, header, first_pass))
+			cout << "Resuming after pass " << first_pass << "/" << n_passes << endl;
+		else {
+			cerr << checkpoint << " is broken or was written with other settings" << endl;
+			return 1;
+		}
 	}
-}
 
-hittable *random_scene() {
-	int n = 8; // Only use mulptiole of 4
-	int arr_size = pow(4, n/4)+4;
-	hittable **list = new hittable*[arr_size];
-
-	// Checker ground
-	texture *checker = new checker_texture(
-    						new constant_texture(vec3(0.2, 0.3, 0.1)),
-    						new constant_texture(vec3(0.9, 0.9, 0.9)));
-	list[0] = new sphere(vec3(0,-1000,0), 1000, new lambertian(checker));
-
-	// Plane ground
-	//list[0] =  new sphere(vec3(0,-1000,0), 1000, new lambertian(new constant_texture(vec3(0.5, 0.5, 0.5))));
-	
-	int i = 1;
-	for (int a = -n/4; a < n/4; a++) {
-		for (int b = -n/4; b < n/4; b++) {
-			float choose_mat = random_double();
-			vec3 center(a+2.5*random_double(),0.2,b+2.5*random_double());
-
-			if ((center-vec3(4,0.2,0)).length() > 0.9) {
-				if (choose_mat < 0.8) {  // diffuse
-					list[i++] = new moving_sphere(
-						center,
-						center+vec3(0, 0.5*random_double(), 0),
-						0.0, 1.0, 0.2,
-						new lambertian(new constant_texture(
-							vec3(random_double()*random_double(),
-								random_double()*random_double(),
-								random_double()*random_double())
-						))
-					);
-				}
-				else if (choose_mat < 0.95) { // metal
-					list[i++] = new sphere(center, 0.2,
-							new metal(vec3(0.5*(1 + random_double()),
-										   0.5*(1 + random_double()),
-										   0.5*(1 + random_double())),
-									  0.5*random_double()));
-				}
-				else {  // glass
-					list[i++] = new sphere(center, 0.2, new dielectric(1.5));
+	typedef std::chrono::steady_clock clock_type;
+	clock_type::time_point last_checkpoint = clock_type::now();
+
+	// Samples restored by a resume are not part of this run's counters
+	long long samples_before = 0;
+	for (int k = 0; k < nx*ny; k++) samples_before += accum.pixels[k].n;
+
+	for (int pass = first_pass; pass < n_passes; pass++) {
+		int first_sample = pass * pass_spp;
+		int end_sample = std::min(first_sample + pass_spp, ns);
+
+		// Send a ray out of eye (0, 0, 0) from BL to UR corner
+		auto render_tile = [&](const tile& t, int thread_id) {
+			if (mmap_file && mapped.tile_done(t.index)) return;
+			perf_worker_scope worker_scope(thread_id);
+			trace_bind_worker(thread_id);
+			trace_scope tile_event("tile", "render", 0, t.index);
+
+			sampler& smp = thread_sampler();
+			for (int j = t.y0; j < t.y1; j++) {
+				for (int i = t.x0; i < t.x1; i++) {
+					// Super sampling
+					accum_pixel& px = accum.at(i, j);
+					pixel_estimate estimate;
+					// px.n is first_sample, unless the pixel was partly rendered before a resume
+					while (px.n < end_sample) {
+						// Random numbers of this sample only depend on (seed, pixel, sample index)
+						smp.start_sample(seed, j*nx + i, px.n);
+
+						//hammersley_point = hm->get_hammersley(n+1, 2, ns);
+						//float u = float(i + hammersley_point[0]) / float(nx);
+						//float v = float(j + hammersley_point[1]) / float(ny);
+
+						// Offset by random_float value [0, 1)
+						float u = float(i + random_float()) / float(nx);
+						float v = float(j + random_float()) / float(ny);
+						ray r = cam.get_ray(u, v);
+
+						vec3 c = de_nan(integrator.li(r));
+						px.sum += c;
+						px.n++;
+
+						// Stop once the pixel's mean is known well enough
+						if (adaptive.enabled) {
+							estimate.add(c);
+							if (px.n >= min_spp && estimate.converged(adaptive.max_error)) break;
+						}
+					}
 				}
 			}
+
+			if (mmap_file) mapped.mark_tile(t.index);
+		};
+		{
+			perf_scope render_scope("render");
+			trace_scope pass_event("pass", "render", 0, pass);
+			scheduler.run(render_tile);
+		}
+
+		if (mmap_file) mapped.finish_pass();
+		if (n_passes > 1) cout << "Pass " << pass+1 << "/" << n_passes << " done" << endl;
+
+		std::chrono::duration<float> since_checkpoint = clock_type::now() - last_checkpoint;
+		if (checkpoint && (since_checkpoint.count() >= checkpoint_interval || pass+1 == n_passes)) {
+			header.passes_done = pass+1;
+			trace_scope event("save_checkpoint", "output", checkpoint);
+			if (!accum.save_checkpoint(checkpoint, header))
+				cerr << "Failed to write checkpoint " << checkpoint << endl;
+			last_checkpoint = clock_type::now();
 		}
 	}
 
-	list[i++] = new sphere(vec3(0, 1, 0), 1.0, new dielectric(1.5));
-	list[i++] = new sphere(vec3(-4, 1, 0), 1.0, new lambertian(new constant_texture(vec3(0.4, 0.2, 0.1))));
-	list[i++] = new sphere(vec3(4, 1, 0), 1.0, new metal(vec3(0.7, 0.6, 0.5), 0.0));
+	framebuffer fb(nx, ny);
+	accum.resolve(fb); // average sum
 
-	return new hittable_list(list,i);
-}
+	std::vector<int> spp(nx*ny);
+	for (size_t k = 0; k < spp.size(); k++) spp[k] = accum.pixels[k].n;
+	mapped.close();
 
-hittable *moving_spheres_zoomin() {
-	hittable **list = new hittable*[4];
-	list[0] = new moving_sphere(vec3(0,0,-1), vec3(0,0,-1)+vec3(0, 0.5*random_double(), 0), 0.0, 1.0, 0.2,
-									new lambertian(new constant_texture(
-											vec3(random_double()*random_double(),
-											random_double()*random_double(),
-											random_double()*random_double())
-										))
-					);
-	list[1] = new moving_sphere(vec3(1,0,-1), vec3(1,0,-1)+vec3(0, 0.5*random_double(), 0), 0.0, 1.0, 0.2,
-									new lambertian(new constant_texture(
-											vec3(random_double()*random_double(),
-											random_double()*random_double(),
-											random_double()*random_double())
-										))
-					);
-	list[2] = new moving_sphere(vec3(-1,0,-1), vec3(-1,0,-1)+vec3(0, 0.5*random_double(), 0), 0.0, 1.0, 0.2,
-									new lambertian(new constant_texture(
-											vec3(random_double()*random_double(),
-											random_double()*random_double(),
-											random_double()*random_double())
-										))
-					);
-	list[3] = new sphere(vec3(0,-100.5,-1), 100, new lambertian(new constant_texture(vec3(0.5, 0.5, 0.5))));
-	return new hittable_list(list, 4);
-}
+	if (adaptive.enabled) {
+		long long total = 0;
+		for (size_t k = 0; k < spp.size(); k++) total += spp[k];
+		cout << "Adaptive sampling: " << total << " samples, " << double(total) / spp.size()
+			 << " spp on average (" << min_spp << "-" << ns << ")" << endl;
+	}
+#ifdef PT_STATS
+	// Counts cover the passes rendered by this run (not the ones restored by --resume)
+	print_stats(collect_stats());
+#endif
+
+	// Traversal cost of the camera rays, after the counters above have been reported
+	if (heatmap) {
+		traversal_cost cost(nx, ny);
+		int heatmap_spp = std::min(ns, 16); // a few jittered rays per pixel are enough for an average
+		measure_traversal_cost(world, cam, heatmap_spp, seed, scheduler, cost);
+		cout << "Camera ray cost: " << mean_value(cost.nodes) << " BVH nodes (max " << max_value(cost.nodes) << "), "
+			 << mean_value(cost.prims) << " primitive tests (max " << max_value(cost.prims) << ")" << endl;
+		if (!write_traversal_cost(heatmap, cost))
+			cerr << "Failed to write the heatmap " << heatmap << "_nodes.ppm/_prims.ppm/.pfm" << endl;
+	}
 
-hittable *two_spheres() {
-	texture *checker = new checker_texture(
-		new constant_texture(vec3(0.2, 0.3, 0.1)),
-		new constant_texture(vec3(0.9, 0.9, 0.9))
-	);
+	{
+		perf_scope scope("output");
+		trace_scope event("output", "output");
+		if (spp_image && !write_spp_image(spp_image, spp, nx, ny, ns))
+			cerr << "Failed to write " << spp_image << endl;
+
+		// Linear radiance is kept next to the 8-bit image, so it can be tonemapped again later
+		if (!fb.write_pfm(output_pfm.c_str()))
+			cerr << "Failed to write " << output_pfm << endl;
+		if (hdr_output && !fb.write_hdr(hdr_output))
+			cerr << "Failed to write " << hdr_output << endl;
+		if (!write_ppm(output.c_str(), tonemap(fb, ts), nx, ny))
+			cerr << "Failed to write " << output << endl;
+	}
 
-	hittable **list = new hittable*[2];
-	list[0] = new sphere(vec3(0,-10, 0), 10, new lambertian(checker));
-	list[1] = new sphere(vec3(0, 10, 0), 10, new lambertian(checker));
+	// Render phase per ray with the ray counters, per path (sample) otherwise
+	long long samples = -samples_before;
+	for (size_t k = 0; k < spp.size(); k++) samples += spp[k];
+#ifdef PT_STATS
+	print_perf_report("render", collect_stats().rays, "ray");
+#else
+	print_perf_report("render", uint64_t(samples), "path");
+#endif
 
-	return new hittable_list(list, 2);
+	cout << "Path Tracer Completed!" << endl;
+	return 0;
 }
 
-hittable *two_perlin_spheres() {
-	texture *pertext = new noise_texture(4);
-	hittable **list = new hittable*[2];
-	list[0] = new sphere(vec3(0,-1000, 0), 1000, new lambertian(pertext));
-	list[1] = new sphere(vec3(0, 2, 0), 2, new lambertian(pertext));
-	return new hittable_list(list, 2);
-}
+// Flattens lists and BVHs into their objects, and remembers BVHs hidden below wrappers
+void collect_primitives(hittable *h, vector<hittable*>& prims, vector<const vector<hittable*>*>& nested) {
+	if (hittable_list *hl = dynamic_cast<hittable_list*>(h)) {
+		for (int i = 0; i < hl->list_size; i++) collect_primitives(hl->list[i], prims, nested);
+		return;
+	}
+	if (const vector<hittable*> *objects = bvh_objects(h)) {
+		for (size_t i = 0; i < objects->size(); i++) collect_primitives((*objects)[i], prims, nested);
+		return;
+	}
 
-hittable *image_textured_spheres() {
-	int nx, ny, nn;
-	unsigned char *tex_data = stbi_load("../texture_img/earthmap.jpg", &nx, &ny, &nn, 0);
-	material *mat = new lambertian(new image_texture(tex_data, nx, ny), texture_map);
+	prims.push_back(h);
 
-	texture *pertext = new noise_texture(4);
-	hittable **list = new hittable*[2];
-	list[0] = new sphere(vec3(0,-1000, 0), 1000, new lambertian(pertext));
-	list[1] = new sphere(vec3(0, 2, 0), 2, mat);
-	return new hittable_list(list, 2);
+	hittable *inner = h;
+	for (;;) {
+		if (translate *tr = dynamic_cast<translate*>(inner)) inner = tr->ptr;
+		else if (rotate_y *ro = dynamic_cast<rotate_y*>(inner)) inner = ro->ptr;
+		else if (flip_normals *fl = dynamic_cast<flip_normals*>(inner)) inner = fl->ptr;
+		else if (constant_medium *cm = dynamic_cast<constant_medium*>(inner)) inner = cm->boundary;
+		else break;
+	}
+	if (const vector<hittable*> *objects = bvh_objects(inner)) nested.push_back(objects);
 }
 
-hittable *simple_light() {
-	texture *pertext = new noise_texture(4);
-	hittable **list = new hittable*[4];
-	list[0] = new sphere(vec3(0,-1000, 0), 1000, new lambertian(pertext));
-	list[1] = new sphere(vec3(0, 2, 0), 2, new lambertian(pertext));
-	list[2] = new sphere(vec3(0, 7, 0), 2, new diffuse_light(new constant_texture(vec3(4,4,4))));
-    list[3] = new xy_rect(3, 5, 1, 3, -2, new diffuse_light(new constant_texture(vec3(4,4,4))));
-	return new hittable_list(list,4);
-}
+void print_bvh_cost(const char *name, const vector<hittable*>& prims) {
+	vector<aabb> bounds;
+	for (size_t i = 0; i < prims.size(); i++) {
+		aabb b;
+		if (prims[i]->bounding_box(0, 1, b)) bounds.push_back(b);
+	}
 
-hittable *cornell_box() {
-	hittable **list = new hittable*[11];
-	int i = 0;
-	material *red = new lambertian(new constant_texture(vec3(0.65, 0.05, 0.05)));
-	material *white = new lambertian(new constant_texture(vec3(0.73, 0.73, 0.73)));
-	material *green = new lambertian(new constant_texture(vec3(0.12, 0.45, 0.15)));
-	material *yellow = new lambertian(new constant_texture(vec3(1.0, 0.96, 0.31)));
-	material *light = new diffuse_light(new constant_texture(vec3(15, 15, 15)));
-
-	material *turbtext = new lambertian(new noise_texture(0.1));
-	material *pertext = new lambertian(new noise_texture_perlin(0.1));
-
-	// Warm light
-	//material *light = new diffuse_light(new constant_texture(vec3(16.86 + 5.0, 8.76+2.0 + 5.0, 3.2+0.5 + 5.0)));
-
-	list[i++] = new flip_normals(new yz_rect(0, 555, 0, 555, 555, green));
-	list[i++] = new yz_rect(0, 555, 0, 555, 0, red);
-	list[i++] = new flip_normals(new xz_rect(213, 343, 227, 332, 554, light));
-	list[i++] = new flip_normals(new xz_rect(0, 555, 0, 555, 555, white));
-	list[i++] = new xz_rect(0, 555, 0, 555, 0, white);
-	//list[i++] = new flip_normals(new xy_rect(0, 555, 0, 555, 555, white));
-
-
-	////////////// Last shot /////////////////
-	int nx, ny, nn;
-	unsigned char *tex_data = stbi_load("../texture_img/thankyou.jpg", &nx, &ny, &nn, 0);
-	material *img_mat = new lambertian(new image_texture(tex_data, nx, ny), texture_map);
-	list[i++] = new flip_normals(new xy_rect(0, 555, 0, 555, 555, img_mat));
-
-	tex_data = stbi_load("../texture_img/bunny.jpg", &nx, &ny, &nn, 0);
-	img_mat = new lambertian(new image_texture(tex_data, nx, ny), texture_map);
-	list[i++] = new translate(
-					new rotate_y(new box(vec3(0,0,0), vec3(120,120,120), img_mat), -18),
-					vec3(130,0,200));
-
-
-	// Two boxes in the room
-	/*
-	// Small box
-	list[i++] = new translate(
-					new rotate_y(new box(vec3(0,0,0), vec3(165,165,165), white), -18),
-					vec3(130,0,65));
-	// Tall box
-	list[i++] = new translate(
-					new rotate_y(new box(vec3(0, 0, 0), vec3(165, 330, 165), white),  15),
-					vec3(265,0,295));
-	*/
-
-
-	////////////// All textures /////////////////
-	/*
-	material *turbtext = new lambertian(new noise_texture(0.1));
-	material *pertext = new lambertian(new noise_texture_perlin(0.1));
-
-	// Checker tall box
-	texture *checker = new checker_texture(
-		new constant_texture(vec3(0.2, 0.3, 0.1)),
-		new constant_texture(vec3(0.9, 0.9, 0.9))
-	);
-	list[i++] = new translate(
-					new rotate_y(new box(vec3(0, 0, 0), vec3(165, 330, 165), new lambertian(checker)),  15),
-					vec3(265,0,295));
-
-	// Image textured medium box
-	int nx, ny, nn;
-	unsigned char *tex_data = stbi_load("../texture_img/trojans_flip.png", &nx, &ny, &nn, 0);
-	material *img_mat = new lambertian(new image_texture(tex_data, nx, ny), texture_map);
-	list[i++] = new translate(
-					new rotate_y(new box(vec3(0,0,0), vec3(165,165,165), img_mat), -18),
-					vec3(130,0,65));
-
-	// Noises on sphere
-	list[i++] = new sphere(vec3(380, 0, 180), 100, pertext);
-	//list[i++] = new rotate_y(new sphere(vec3(280, 40, 150), 40, turbtext), 15);
-
-	// Turbulence floor
-	list[i++] = new xz_rect(0, 555, 0, 555, 0, turbtext);
-	*/
-
-	// Solid small box
-	/*
-	list[i++] = new translate(
-					new rotate_y(new box(vec3(0,0,0), vec3(70,70,70), yellow), 5),
-					vec3(200,165,120));
-	*/
-
-	/*
-	////////////// glass sphere //////////////
-	material *glass = new dielectric(1.5);
-    list[i++] = new sphere(vec3(190, 90, 190),90 , glass);
-    */
-
-
-    ////////////// Metal box tall //////////////
-    /*
-	material *aluminum = new metal(vec3(0.8, 0.85, 0.88), 0.0);
-	list[i++] = new translate(
-					new rotate_y(new box(vec3(0, 0, 0), vec3(165, 330, 165), aluminum),  15),
-					vec3(265,0,295));
-	*/
-
-
-
-	////////// Last image //////////
-	/*
-	int nx, ny, nn;
-	unsigned char *tex_data = stbi_load("../texture_img/thankyou.png", &nx, &ny, &nn, 0);
-	material *img_mat = new lambertian(new image_texture(tex_data, nx, ny), texture_map);
-	list[i++] = new flip_normals(new xy_rect(0, 555, 0, 555, 555, img_mat));
-
-	tex_data = stbi_load("../texture_img/tommy.jpg", &nx, &ny, &nn, 0);
-	img_mat = new lambertian(new image_texture(tex_data, nx, ny), texture_map);
-	list[i++] = new translate(
-					new rotate_y(new box(vec3(0, 0, 0), vec3(165, 330, 165), img_mat),  15),
-					vec3(265,0,295));
-	*/
-
-	return new hittable_list(list,i);
-}
+	bvh_builder median(bounds, 2, split_median);
+	bvh_builder sah(bounds);
+	float c_median = median.sah_cost();
+	float c_sah = sah.sah_cost();
 
-hittable *cornell_smoke() {
-	hittable **list = new hittable*[8];
-	int i = 0;
-	material *red = new lambertian(new constant_texture(vec3(0.65, 0.05, 0.05)));
-	material *white = new lambertian(new constant_texture(vec3(0.73, 0.73, 0.73)));
-	material *green = new lambertian(new constant_texture(vec3(0.12, 0.45, 0.15)));
-	material *light = new diffuse_light(new constant_texture(vec3(7, 7, 7)));
-
-	list[i++] = new flip_normals(new yz_rect(0, 555, 0, 555, 555, green));
-	list[i++] = new yz_rect(0, 555, 0, 555, 0, red);
-	list[i++] = new xz_rect(113, 443, 127, 432, 554, light);
-	list[i++] = new flip_normals(new xz_rect(0, 555, 0, 555, 555, white));
-	list[i++] = new xz_rect(0, 555, 0, 555, 0, white);
-	list[i++] = new flip_normals(new xy_rect(0, 555, 0, 555, 555, white));
-
-	hittable *b1 = new translate(
-						new rotate_y(new box(vec3(0, 0, 0), vec3(165, 165, 165), white), -18),
-						vec3(130,0,65));
-	hittable *b2 = new translate(
-						new rotate_y(new box(vec3(0, 0, 0), vec3(165, 330, 165), white),  15),
-						vec3(265,0,295));
-
-	list[i++] = new constant_medium(b1, 0.01, new constant_texture(vec3(1.0, 1.0, 1.0)));
-    list[i++] = new constant_medium(b2, 0.01, new constant_texture(vec3(0.0, 0.0, 0.0)));
-
-	return new hittable_list(list,i);
+	printf("%-24s %8d %12.2f %12.2f %8.2fx\n", name, int(bounds.size()), c_median, c_sah,
+		   c_sah > 0 ? c_median / c_sah : 0.0f);
 }
 
-hittable *final() {
-	int nb = 20;
-	hittable **list = new hittable*[30];
-	hittable **boxlist = new hittable*[10000];
-	hittable **boxlist2 = new hittable*[10000];
-	material *white = new lambertian( new constant_texture(vec3(0.73, 0.73, 0.73)));
-	material *ground = new lambertian( new constant_texture(vec3(0.48, 0.83, 0.53)));
-
-	int b = 0;
-	for (int i = 0; i < nb; i++) {
-		for (int j = 0; j < nb; j++) {
-			float w = 100;
-			float x0 = -1000 + i*w;
-			float z0 = -1000 + j*w;
-			float y0 = 0;
-			float x1 = x0 + w;
-			float y1 = 100*(random_double()+0.01);
-			float z1 = z0 + w;
-			boxlist[b++] = new box(vec3(x0,y0,z0), vec3(x1,y1,z1), ground);
+// SAH cost of the original median builder against the binned SAH builder, for a BVH over every built-in scene
+void report_bvh_cost(uint64_t seed) {
+	printf("%-24s %8s %12s %12s %9s\n", "scene", "objects", "median", "sah", "gain");
+	for (int k = 0; k < scene_count; k++) {
+		thread_sampler().seed(seed);
+		hittable *world = build_scene(scene_registry[k]);
+
+		vector<hittable*> prims;
+		vector<const vector<hittable*>*> nested;
+		collect_primitives(world, prims, nested);
+		print_bvh_cost(scene_registry[k].name, prims);
+
+		for (size_t i = 0; i < nested.size(); i++) {
+			string name = string(scene_registry[k].name) + "/nested";
+			print_bvh_cost(name.c_str(), *nested[i]);
 		}
 	}
-	int l = 0;
-	list[l++] = new bvh_node(boxlist, b, 0, 1);
-	material *light = new diffuse_light( new constant_texture(vec3(7, 7, 7)));
-	list[l++] = new xz_rect(123, 423, 147, 412, 554, light);
-	vec3 center(400, 400, 200);
-	list[l++] = new moving_sphere(center, center+vec3(30, 0, 0),
-								0, 1, 50, new lambertian(new constant_texture(vec3(0.7, 0.3, 0.1))));
-	list[l++] = new sphere(vec3(260, 150, 45), 50, new dielectric(1.5));
-	list[l++] = new sphere(vec3(0, 150, 145), 50, new metal(vec3(0.8, 0.8, 0.9), 10.0));
-	hittable *boundary = new sphere(vec3(360, 150, 145), 70, new dielectric(1.5));
-	list[l++] = boundary;
-	list[l++] = new constant_medium(boundary, 0.2, new constant_texture(vec3(0.2, 0.4, 0.9)));
-	boundary = new sphere(vec3(0, 0, 0), 5000, new dielectric(1.5));
-	list[l++] = new constant_medium(boundary, 0.0001, new constant_texture(vec3(1.0, 1.0, 1.0)));
-	int nx, ny, nn;
-	unsigned char *tex_data = stbi_load("../texture_img/earthmap.jpg", &nx, &ny, &nn, 0);
-	material *emat =  new lambertian(new image_texture(tex_data, nx, ny), texture_map);
-	list[l++] = new sphere(vec3(400, 200, 400), 100, emat);
-	texture *pertext = new noise_texture(0.1);
-	list[l++] =  new sphere(vec3(220, 280, 300), 80, new lambertian( pertext ));
-
-	int ns = 1000;
-	for (int j = 0; j < ns; j++) {
-		boxlist2[j] = new sphere(vec3(165*random_double(), 165*random_double(), 165*random_double()), 10, white);
-	}
-	list[l++] = new translate(new rotate_y(new bvh_node(boxlist2, ns, 0.0, 1.0), 15), vec3(-100,270,395));
-
-	return new hittable_list(list,l);
 }
 
-/*
-void cornell_box(hittable **scene, camera **cam, float aspect) {
-	int i = 0;
-	hittable **list = new hittable*[8];
-
-	material *red = new lambertian( new constant_texture(vec3(0.65, 0.05, 0.05)) );
-	material *white = new lambertian( new constant_texture(vec3(0.73, 0.73, 0.73)) );
-	material *green = new lambertian( new constant_texture(vec3(0.12, 0.45, 0.15)) );
-	material *light = new diffuse_light( new constant_texture(vec3(15, 15, 15)) );
-
-	list[i++] = new flip_normals(new yz_rect(0, 555, 0, 555, 555, green));
-	list[i++] = new yz_rect(0, 555, 0, 555, 0, red);
-	list[i++] = new xz_rect(213, 343, 227, 332, 554, light);
-	list[i++] = new flip_normals(new xz_rect(0, 555, 0, 555, 555, white));
-	list[i++] = new xz_rect(0, 555, 0, 555, 0, white);
-	list[i++] = new flip_normals(new xy_rect(0, 555, 0, 555, 555, white));
-	list[i++] = new translate(new rotate_y(
-		new box(vec3(0, 0, 0), vec3(165, 165, 165), white), -18), vec3(130,0,65));
-	list[i++] = new translate(new rotate_y(
-		new box(vec3(0, 0, 0), vec3(165, 330, 165), white),  15), vec3(265,0,295));
-
-	*scene = new hittable_list(list, i);
-	vec3 lookfrom(278, 278, -800);
-	vec3 lookat(278, 278, 0);
-	float dist_to_focus = 10.0;
-	float aperture = 0.0;
-	float vfov = 40.0;
-	*cam = new camera(lookfrom, lookat, vec3(0,1,0),
-					vfov, aspect, aperture, dist_to_focus, 0.0, 1.0);
+bool ends_with(const string& s, const char *suffix) {
+	size_t n = strlen(suffix);
+	return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
 }
-*/
-
-
-
-